@@ -139,10 +139,47 @@ HET_API het_State *(het_newthread)(het_State * L);
 HET_API int(het_closethread)(het_State *L, het_State *from);
 HET_API int(het_resetthread)(het_State *L); /* Deprecated */
 
+/*
+** recycling of threads: keep up to 'max' collected threads, with their
+** stacks trimmed to 'stacksize' slots, for 'het_newthread' to reuse
+*/
+typedef struct het_ThreadPoolStats {
+    unsigned long hits; /* 'het_newthread' calls served by the pool */
+    unsigned long misses; /* 'het_newthread' calls that allocated */
+    unsigned long recycled; /* collected threads kept in the pool */
+    unsigned long discarded; /* collected threads freed (pool full) */
+    int size; /* threads now in the pool */
+} het_ThreadPoolStats;
+
+HET_API void(het_setthreadpool)(het_State *L, int max, int stacksize);
+HET_API void(het_threadpoolstats)(het_State *L, het_ThreadPoolStats *st);
+
+/*
+** statistics of the state lock (built with HET_USE_STATELOCK); times
+** are in microseconds
+*/
+typedef struct het_LockStats {
+    unsigned long acquires; /* times the lock was taken */
+    unsigned long contended; /* acquires that had to wait */
+    unsigned long waittime; /* total time spent waiting */
+    unsigned long maxwait; /* longest wait */
+    unsigned long handoffs; /* yield points that let a waiter in */
+} het_LockStats;
+
+HET_API int(het_lockstats)(het_State *L, het_LockStats *st, int reset);
+
 HET_API het_CFunction(het_atpanic)(het_State *L, het_CFunction panicf);
 
 HET_API het_Number(het_version)(het_State *L);
 
+/*
+** process-wide pool of interned strings, shared by all states; it must
+** be filled before the first state that uses it is created
+** (het_sharestrings returns -1 afterwards, as on memory errors)
+*/
+HET_API int(het_sharestrings)(const char *const *strs, int n);
+HET_API void(het_releasestrings)(void);
+
 /*
 ** basic stack manipulation
 */
@@ -266,6 +303,42 @@ HET_API int(het_load)(het_State *L, het_Reader reader, void *dt,
 
 HET_API int(het_dump)(het_State *L, het_Writer writer, void *data, int strip);
 
+/*
+** flags for the 'strip' argument of 'het_dump' (any other true value
+** is the same as HET_DUMPSTRIP, as in older versions)
+*/
+#define HET_DUMPSTRIP 1 /* leave out debug information */
+#define HET_DUMPALIGNED 2 /* aligned format (see het_chunk.h) */
+
+/*
+** Load a precompiled chunk from memory that stays valid and unchanged
+** while any function loaded from it is alive (e.g. a mapped file).
+** Instruction and line arrays are used in place when suitably aligned;
+** string constants are interned when first needed.
+*/
+HET_API int(het_loadfixed)(het_State *L, const char *buff, size_t sz,
+                           const char *chunkname, const char *mode);
+
+/*
+** Load a batch of chunks. Readers run on up to 'nworkers' helper
+** threads (with L == NULL), which also check binary chunks and parse
+** text chunks in scratch states of their own; functions are then
+** created in 'L' on the calling thread, in order. Pushes one value per
+** chunk (the function or an error message), sets each 'status' and
+** returns the number of failures, or -1 (pushing nothing) if the stack
+** cannot grow by 'n' or memory is short.
+*/
+typedef struct het_ChunkSource {
+    het_Reader reader;
+    void *data;
+    const char *chunkname;
+    const char *mode;
+    int status; /* result of loading this chunk */
+} het_ChunkSource;
+
+HET_API int(het_loadmany)(het_State *L, het_ChunkSource *srcs, int n,
+                          int nworkers);
+
 /*
 ** coroutine functions
 */
@@ -298,9 +371,52 @@ HET_API void(het_warning)(het_State *L, const char *msg, int tocont);
 #define HET_GCISRUNNING 9
 #define HET_GCGEN 10
 #define HET_GCINC 11
+#define HET_GCSTATS 12
+#define HET_GCSTEPTIME 13
+#define HET_GCPARALLEL 14
 
 HET_API int(het_gc)(het_State *L, int what, ...);
 
+/*
+** 'het_gc(L, HET_GCPARALLEL, n)' makes full collections mark with 'n'
+** threads (built with HET_USE_PARMARK; 1 is serial) and returns the
+** previous number. The threads are created for each collection, unless
+** the host lends its own with 'het_setgcrunner': a runner must call
+** 'work(arg)' 'n' times, concurrently as far as it can (one call may be
+** on the calling thread), and return when all calls have returned.
+*/
+typedef void (*het_GCRunner)(void *ud, void (*work)(void *arg), void *arg,
+                             int n);
+
+HET_API void(het_setgcrunner)(het_State *L, het_GCRunner f, void *ud);
+
+/*
+** 'het_gc(L, HET_GCSTEPTIME, us)' does incremental collection work for
+** at most 'us' microseconds, stopping at the first safe point after the
+** budget runs out, and returns 1 if it finished a cycle. (The atomic
+** phase cannot be split, so a step entering it may exceed the budget.)
+*/
+
+/*
+** Collector statistics, filled by 'het_gc(L, HET_GCSTATS, st, reset)'.
+** Times are in microseconds. Bucket 'i' of a histogram counts pauses
+** 'd' with 2^(i-1) <= d < 2^i (bucket 0 counts pauses under 1us; the
+** last bucket also counts all longer pauses).
+*/
+#define HET_GCHISTSIZE 24
+
+typedef struct het_GCStats {
+    unsigned long nsteps; /* number of incremental steps */
+    unsigned long ncycles; /* number of completed cycles */
+    unsigned long maxstep; /* longest step */
+    unsigned long maxcycle; /* longest total pause of a cycle */
+    unsigned long steptime; /* total time spent in steps */
+    size_t traversed; /* bytes traversed by the mark phase */
+    size_t freed; /* objects freed by the sweep phase */
+    unsigned long stephist[HET_GCHISTSIZE]; /* durations of steps */
+    unsigned long cyclehist[HET_GCHISTSIZE]; /* total pause per cycle */
+} het_GCStats;
+
 /*
 ** miscellaneous functions
 */
@@ -411,6 +527,15 @@ HET_API int (het_gethookcount) (het_State *L);
 
 HET_API int (het_setcstacklimit) (het_State *L, unsigned int limit);
 
+/*
+** instruction counts of the function on the top of the stack and of
+** its nested functions (builds with HET_USE_OPPROFILE; elsewhere it
+** returns -1): write a report with 'writer', or clear them if 'writer'
+** is NULL
+*/
+HET_API int (het_opprofile) (het_State *L, int nhot, het_Writer writer,
+                             void *data);
+
 struct het_Debug {
     int event;
     const char *name; /* (n) */
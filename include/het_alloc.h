@@ -0,0 +1,70 @@
+/*
+** Built-in memory allocators for het_newstate
+*/
+#ifndef het_alloc_h
+#define het_alloc_h
+
+#include "het.h"
+
+/*
+** Size-class pool. Blocks up to HET_POOLMAXSIZE bytes are carved from
+** HET_POOLSLAB-byte slabs, one free list per class of HET_POOLGRAIN
+** bytes; larger blocks go to the C library. Het always tells the
+** allocator the old size of a block, so blocks carry no header.
+**
+** A pool is not thread safe: give each thread (or each state) its own.
+**
+**   het_Pool *pool = het_newpool();
+**   het_State *L = het_newstate(het_poolalloc, pool);
+**   ...
+**   het_close(L);
+**   het_closepool(pool);
+*/
+#define HET_POOLGRAIN 16
+#define HET_POOLMAXSIZE 512
+#define HET_POOLNCLASSES (HET_POOLMAXSIZE / HET_POOLGRAIN)
+#define HET_POOLSLAB (64 * 1024)
+
+typedef struct het_Pool het_Pool;
+
+typedef struct het_PoolStats {
+    size_t live[HET_POOLNCLASSES]; /* live bytes in each size class */
+    size_t nblocks[HET_POOLNCLASSES]; /* live blocks in each size class */
+    size_t largelive; /* live bytes in blocks above HET_POOLMAXSIZE */
+    size_t slabs; /* number of slabs allocated */
+} het_PoolStats;
+
+HET_API het_Pool *(het_newpool)(void);
+HET_API void (het_closepool)(het_Pool *p);
+HET_API void *(het_poolalloc)(void *ud, void *ptr, size_t osize,
+                              size_t nsize);
+HET_API void (het_poolstats)(het_Pool *p, het_PoolStats *st);
+
+/*
+** Arena. Blocks are bump-allocated from HET_ARENACHUNK-byte chunks
+** (bigger blocks get a chunk of their own, aside) and individual frees
+** are no-ops, except that the most recent block of the current chunk
+** can shrink, grow or be freed in place. Everything is released at once by 'het_closearena',
+** or kept for reuse by 'het_resetarena'. Meant for short-lived states:
+**
+**   het_State *L = het_newstate(het_arenaalloc, arena);
+**   ... run the request ...
+**   het_close(L);
+**   het_resetarena(arena);
+**
+** As frees are no-ops, 'het_close' only pays for walking the object
+** lists; the state can also compare its allocator with 'het_arenaalloc'
+** to skip that walk when no object has a pending finalizer.
+*/
+#define HET_ARENACHUNK (256 * 1024)
+
+typedef struct het_Arena het_Arena;
+
+HET_API het_Arena *(het_newarena)(void);
+HET_API void (het_closearena)(het_Arena *a);
+HET_API void (het_resetarena)(het_Arena *a);
+HET_API void *(het_arenaalloc)(void *ud, void *ptr, size_t osize,
+                               size_t nsize);
+HET_API size_t (het_arenaused)(het_Arena *a);
+
+#endif
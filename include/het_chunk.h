@@ -0,0 +1,131 @@
+/*
+** Aligned format for precompiled chunks
+*/
+#ifndef het_chunk_h
+#define het_chunk_h
+
+#include "het_limits.h"
+#include "het_object.h"
+
+/*
+** Besides the byte-serialized format, 'het_dump' with HET_DUMPALIGNED
+** writes chunks where every array of every prototype is stored with its
+** natural alignment, so that a loader can validate the whole chunk once
+** and then adopt each array with a single 'memcpy' (or use it in place,
+** for a chunk kept in memory by 'het_loadfixed').
+**
+** Layout (all offsets from the start of the chunk, which must itself be
+** aligned to HETC_ALIGN):
+**
+**   ChunkHeader
+**   ChunkSection[nsections]   sorted by (proto, kind), unique
+**   section data              each at a multiple of its element alignment
+**
+** Prototypes are numbered in preorder (the main function is 0). Strings
+** (constants, source and debug names) are referred to by their index in
+** the HETC_SSTRINGS section; each entry of that section gives the offset
+** and length of the string in the HETC_SCHARS section, whose contents
+** are NUL-terminated.
+*/
+
+#define HETC_VERSION (HET_VERSION_NUM * 16 + 1)
+#define HETC_FORMAT 1 /* aligned format (0 is the byte-serialized one) */
+#define HETC_ALIGN 16 /* alignment of the chunk and maximum of any section */
+
+/* test values, to detect byte order and number format */
+#define HETC_INT 0x5678
+#define HETC_NUM cast_num(370.5)
+
+/* no string */
+#define HETC_NOSTRING (~(h_uint32)0)
+
+/* section kinds, in the order they appear for each prototype */
+enum {
+    HETC_SPROTO, /* ChunkProto (exactly one per prototype) */
+    HETC_SCODE, /* Instruction */
+    HETC_SCONST, /* ChunkConst */
+    HETC_SUPVAL, /* ChunkUpval */
+    HETC_SPROTOS, /* h_uint32: indices of nested prototypes */
+    HETC_SLINEINFO, /* hs_byte */
+    HETC_SABSLINE, /* AbsLineInfo */
+    HETC_SLOCVARS, /* ChunkLocVar */
+    HETC_SSTRINGS, /* ChunkString (global: proto 0 only) */
+    HETC_SCHARS, /* char (global: proto 0 only) */
+    HETC_NSECTIONS
+};
+
+typedef struct ChunkHeader {
+    char signature[sizeof(HET_SIGNATURE) - 1];
+    he_byte version; /* HETC_VERSION */
+    he_byte format; /* HETC_FORMAT */
+    he_byte sizeinstruction;
+    he_byte sizeinteger;
+    he_byte sizenumber;
+    he_byte headersize; /* sizeof(ChunkHeader) */
+    he_byte sectionsize; /* sizeof(ChunkSection) */
+    he_byte unused;
+    h_uint32 nprotos;
+    h_uint32 nsections;
+    h_uint32 size; /* total size of the chunk */
+    het_Integer checkint; /* HETC_INT */
+    het_Number checknum; /* HETC_NUM */
+} ChunkHeader;
+
+typedef struct ChunkSection {
+    h_uint32 kind; /* HETC_S* */
+    h_uint32 proto; /* index of the prototype it belongs to */
+    h_uint32 count; /* number of elements */
+    h_uint32 offset; /* start of its elements */
+} ChunkSection;
+
+typedef struct ChunkProto {
+    int linedefined;
+    int lastlinedefined;
+    h_uint32 source; /* string index or HETC_NOSTRING */
+    he_byte numparams;
+    he_byte is_vararg;
+    he_byte maxstacksize;
+    he_byte unused;
+} ChunkProto;
+
+typedef struct ChunkConst {
+    he_byte tt; /* variant tag (HET_VNIL, HET_VSHRSTR, ...) */
+    h_uint32 str; /* string index, for strings */
+    union {
+        het_Integer i;
+        het_Number n;
+    } u;
+} ChunkConst;
+
+typedef struct ChunkUpval {
+    h_uint32 name; /* string index or HETC_NOSTRING */
+    he_byte instack;
+    he_byte idx;
+    he_byte kind;
+} ChunkUpval;
+
+typedef struct ChunkLocVar {
+    h_uint32 varname; /* string index or HETC_NOSTRING */
+    int startpc;
+    int endpc;
+} ChunkLocVar;
+
+typedef struct ChunkString {
+    h_uint32 offset; /* in HETC_SCHARS */
+    h_uint32 len; /* not counting the final NUL */
+} ChunkString;
+
+/* round 'n' up to a multiple of 'a' (a power of 2) */
+#define hetU_alignup(n, a) (((n) + ((a) - 1)) & ~cast_sizet((a) - 1))
+
+#define chunkheader(b) cast(const ChunkHeader *, (b))
+#define chunksections(b) \
+    cast(const ChunkSection *, (b) + sizeof(ChunkHeader))
+
+HETI_FUNC size_t hetU_elemsize(int kind);
+HETI_FUNC size_t hetU_elemalign(int kind);
+HETI_FUNC const char *hetU_checkchunk(const char *buff, size_t size);
+HETI_FUNC const void *hetU_section(const char *buff, h_uint32 proto,
+                                   int kind, h_uint32 *count);
+
+#endif
@@ -105,6 +105,20 @@ compiler non-C99 compliant, which may not have support for `long long`)
 #define HET_C89_NUMBERS 0
 #endif
 
+/*
+@@ HET_NANBOXING packs every value into a single 8-byte word (see
+** 'het_object.h') instead of a value plus a separate tag byte, halving
+** the size of stack slots, array slots and table nodes. Floats must be
+** doubles, integers are restricted to 32 bits and pointers to 47 bits
+** (the user address space of x86-64 and AArch64).
+*/
+/* #define HET_NANBOXING */
+
+#if defined(HET_NANBOXING) && (HET_32BITS || HET_C89_NUMBERS)
+#error "HET_NANBOXING needs 'double' floats and fixes its own integer \
+type; it cannot be combined with HET_32BITS or HET_C89_NUMBERS"
+#endif
+
 #if HET_32BITS
 /*
 ** 32-bit integers and 'float'
@@ -123,6 +137,16 @@ compiler non-C99 compliant, which may not have support for `long long`)
 #define HET_INT_TYPE HET_INT_LONG
 #define HET_FLOAT_TYPE HET_FLOAT_DOUBLE
 
+#elif defined(HET_NANBOXING)
+/*
+** 32-bit integers and 'double', the only mix that fits in a NaN box
+*/
+#if !HETI_IS32INT
+#error "HET_NANBOXING needs a 32-bit 'int'"
+#endif
+#define HET_INT_TYPE HET_INT_INT
+#define HET_FLOAT_TYPE HET_FLOAT_DOUBLE
+
 #else /* use defaults */
 #define HET_INT_TYPE HET_INT_DEFAULT
 #define HET_FLOAT_TYPE HET_FLOAT_DEFAULT
@@ -558,6 +582,21 @@ will use
 #define h_unlikely(x) heti_unlikely(x)
 #endif
 
+/*
+@@ HET_USE_JUMPTABLE controls whether the interpreter loop dispatches
+** through a per-opcode jump table (computed goto, see 'het_jumptab.h')
+** instead of a switch. It needs the "labels as values" extension, so
+** it is on by default only for GCC-compatible compilers. Define it as 0
+** to force the switch.
+*/
+#if !defined(HET_USE_JUMPTABLE)
+#if defined(__GNUC__) && !defined(HET_USE_C89)
+#define HET_USE_JUMPTABLE 1
+#else
+#define HET_USE_JUMPTABLE 0
+#endif
+#endif
+
 /*
 ** Language Variations
 */
@@ -577,6 +616,72 @@ will use
 #define heti_apicheck(l,e)  assert(e)
 #endif
 
+/*
+@@ HET_SPLITNODES stores the hash part of tables as two parallel arrays,
+** one with keys and chain links and one with values, instead of an
+** array of key-value nodes. Lookups that miss or walk long chains then
+** touch only key bytes, at the cost of a second cache line on a hit.
+*/
+/* #define HET_SPLITNODES */
+
+/*
+@@ HET_USE_CTRLBYTES keeps a byte of hash fingerprint per table node, so
+** that lookups of short-string keys (fields, globals, methods) check
+** 16 nodes at a time with SSE2 or NEON instead of walking the collision
+** chain (see 'het_ctrl.h'). Other targets use a scalar loop.
+*/
+/* #define HET_USE_CTRLBYTES */
+
+/*
+@@ HET_USE_TABLESITES lets each OP_NEWTABLE remember the sizes its
+** tables grew to and create the next ones with those sizes, to avoid
+** rehashes when building big tables (see 'hetH_sitesizes'). It costs a
+** pointer per table.
+*/
+/* #define HET_USE_TABLESITES */
+
+/*
+@@ HET_USE_TYPEDARRAYS lets the array part of a table hold plain
+** integers or plain floats, without tags, while it is a sequence of
+** numbers of one type (see 'hetH_arrayget'). Other writes turn it back
+** into an array of values. It adds 8 bytes to every table on 64-bit
+** systems (the header of a table has no padding to reuse).
+*/
+/* #define HET_USE_TYPEDARRAYS */
+
+/*
+@@ HET_USE_VMSTACK makes Het stacks that grow beyond HETI_VMSTACKMIN
+** bytes reserve address space for their maximum size and commit it as
+** they grow, so they stop moving (see 'het_vmstack.h'). At most
+** HETI_MAXVMSTACKS stacks are reserved at once, as each one uses kernel
+** memory mappings. It needs HET_USE_POSIX or Windows and is meant for
+** 64-bit systems.
+*/
+/* #define HET_USE_VMSTACK */
+
+/*
+@@ HET_USE_STATELOCK defines 'het_lock'/'het_unlock' with a lock in the
+** global state, so that OS threads can share a state by calling the
+** API concurrently; the lock serializes them (see 'het_lock.h'). It
+** needs GCC-style atomic builtins.
+*/
+/* #define HET_USE_STATELOCK */
+
+/*
+@@ HET_USE_PARMARK lets full collections run their mark phase on several
+** threads with work-stealing gray queues (see 'het_parmark.h'). It
+** needs GCC-style atomic builtins; the default threads need
+** HET_USE_POSIX.
+*/
+/* #define HET_USE_PARMARK */
+
+/*
+@@ HET_USE_OPPROFILE builds an instrumented interpreter that counts the
+** executions of each instruction of each function (see 'het_opprof.h').
+** It slows down every instruction; use it only to gather profiles.
+*/
+/* #define HET_USE_OPPROFILE */
+
 /*
 @@ HETI_MAXSTACK limits the size of the Het stack.
 */
@@ -0,0 +1,142 @@
+/*
+** Control bytes for the hash part of tables
+*/
+#ifndef het_ctrl_h
+#define het_ctrl_h
+
+#include "het_table.h"
+
+#if defined(HET_USE_CTRLBYTES)
+
+/*
+** With HET_USE_CTRLBYTES a table keeps one control byte per node, in
+** 'Table.ctrl'. A node holding a short-string key has a 7-bit
+** fingerprint of the string hash; any other node is CTRL_EMPTY (free)
+** or CTRL_OTHER (some other kind of key). Nodes are seen in groups of
+** CTRL_GROUP consecutive slots, so that the fingerprints of a whole
+** group are compared with a single vector instruction.
+**
+** The table code keeps colliding keys inside the group of their main
+** position while that group has free slots ('ctrlfreeslot'). When a
+** key has to go elsewhere, the group of its main position is marked as
+** overflowed. A lookup in a group that never overflowed is then decided
+** by one group compare; otherwise it falls back to the chain walk.
+**
+** Layout of 'ctrl': 'ctrlsize(t)' fingerprints (the node count, padded
+** with CTRL_EMPTY up to a full group), followed by one overflow byte per
+** group. 'sizectrl' gives the number of bytes to allocate.
+*/
+
+#define CTRL_GROUP 16
+
+#define CTRL_EMPTY 0x80
+#define CTRL_OTHER 0x81
+
+/* fingerprint of a hash; uses high bits, as 'lmod' uses the low ones */
+#define ctrlh2(h) cast_byte((h) >> 25)
+
+#define ctrlsize(t) \
+    (sizenode(t) < CTRL_GROUP ? CTRL_GROUP : sizenode(t))
+#define ctrlngroups(t) (ctrlsize(t) / CTRL_GROUP)
+#define sizectrl(t) (ctrlsize(t) + ctrlngroups(t))
+
+#define ctrlgroup(i) ((i) & ~(CTRL_GROUP - 1))
+#define ctrloverflow(t,i) ((t)->ctrl[ctrlsize(t) + (i) / CTRL_GROUP])
+#define setctrl(t,i,c) ((t)->ctrl[i] = cast_byte(c))
+
+/*
+** Group matching. Each function returns a mask with bit 'k' set when
+** byte 'k' of the group matches.
+*/
+#if defined(__SSE2__) || defined(_M_X64)
+
+#include <emmintrin.h>
+
+h_sinline unsigned int ctrlmatch(const he_byte *g, he_byte c) {
+    __m128i v = _mm_loadu_si128(cast(const __m128i *, g));
+    return cast_uint(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(v, _mm_set1_epi8(cast_char(c)))));
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+#include <arm_neon.h>
+
+h_sinline unsigned int ctrlmatch(const he_byte *g, he_byte c) {
+    static const he_byte bits[CTRL_GROUP] = {
+        1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+    };
+    uint8x16_t m = vandq_u8(vceqq_u8(vld1q_u8(g), vdupq_n_u8(c)),
+                            vld1q_u8(bits));
+    return cast_uint(vaddv_u8(vget_low_u8(m))) |
+           (cast_uint(vaddv_u8(vget_high_u8(m))) << 8);
+}
+
+#else
+
+h_sinline unsigned int ctrlmatch(const he_byte *g, he_byte c) {
+    unsigned int m = 0;
+    int k;
+    for (k = 0; k < CTRL_GROUP; k++)
+        if (g[k] == c)
+            m |= 1u << k;
+    return m;
+}
+
+#endif
+
+/* index of the lowest bit set in a non-zero match mask */
+#if defined(__GNUC__)
+#define ctrlfirst(m) __builtin_ctz(m)
+#else
+h_sinline int ctrlfirst(unsigned int m) {
+    int k = 0;
+    while (!(m & 1u)) {
+        m >>= 1;
+        k++;
+    }
+    return k;
+}
+#endif
+
+/*
+** Search for short string 'key' using the control bytes. Returns 1
+** when the search is decided, leaving in '*res' the node with the key
+** or NULL if the key is absent; returns 0 when the group of the main
+** position overflowed and the caller must walk the chain.
+*/
+h_sinline int hetH_ctrlfind(const Table *t, const TString *key,
+                            const Node **res) {
+    int mp = lmod(key->hash, sizenode(t));
+    int g = ctrlgroup(mp);
+    unsigned int m = ctrlmatch(t->ctrl + g, ctrlh2(key->hash));
+    while (m != 0) {
+        const Node *n = gnode(t, g + ctrlfirst(m));
+        if (keyisshrstr(n) && gckey(n) == cast(const GCObject *, key)) {
+            *res = n;
+            return 1;
+        }
+        m &= m - 1;
+    }
+    if (ctrloverflow(t, mp))
+        return 0;
+    *res = NULL;
+    return 1;
+}
+
+/*
+** Find a free slot in the group of main position 'mp', or return -1
+** when the group is full (the caller then takes a free position
+** elsewhere and marks the group with 'ctrloverflow').
+*/
+h_sinline int ctrlfreeslot(const Table *t, int mp) {
+    int g = ctrlgroup(mp);
+    unsigned int m = ctrlmatch(t->ctrl + g, CTRL_EMPTY);
+    if (sizenode(t) < CTRL_GROUP) /* ignore padding bytes */
+        m &= (1u << sizenode(t)) - 1;
+    return (m != 0) ? g + ctrlfirst(m) : -1;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,17 @@
+/*
+** Auxiliary functions from the debug interface
+*/
+#ifndef het_debug_h
+#define het_debug_h
+
+#include "het_object.h"
+
+/*
+** mark for entries in 'lineinfo' array that has absolute information in
+** 'abslineinfo' array
+*/
+#define ABSLINEINFO (-0x80)
+
+HETI_FUNC int hetG_getfuncline(const Proto *f, int pc);
+
+#endif
@@ -0,0 +1,47 @@
+/*
+** Integer numeric for loops
+*/
+#ifndef het_forloop_h
+#define het_forloop_h
+
+#include "het_object.h"
+#include "het_opcodes.h"
+
+/*
+** OP_FORPREP of a loop whose initial value and step are integers makes
+** it an integer loop, keeping in R[A+1] the number of iterations still
+** to run. When both are integer constants (a missing step is 1), the
+** code generator knows that before the loop runs, so it closes the loop
+** with OP_FORLOOPI, which runs the integer case of OP_FORLOOP without
+** testing the type of the step. (A float limit is converted by
+** OP_FORPREP, and a non-numeric one raises an error there.) Other loops
+** keep OP_FORLOOP. Code is never rewritten at run time, as the loop
+** instruction is shared by all running activations of the loop.
+**
+** 'hetV_forloopop' gives the loop opcode for 'fornum' in the parser,
+** from the expressions of the initial value and the step (NULL if
+** absent).
+*/
+#define hetV_forloopop(init, step) \
+    (((init)->k == VKINT && ((step) == NULL || (step)->k == VKINT)) \
+        ? OP_FORLOOPI : OP_FORLOOP)
+
+/*
+** Body of OP_FORLOOPI, for the interpreter loop (which defines 'ra',
+** 'pc' and 'i' as usual): R[A] is the internal index, R[A+1] the count
+** and R[A+2] the step, all integers; R[A+3] is the control variable.
+** (Only the debug library could put a float in those registers, which
+** would make the loop wrong but not unsafe.)
+*/
+#define hetV_forloopi() { \
+    het_Unsigned count_ = h_castS2U(ivalue(s2v(ra + 1))); \
+    if (count_ > 0) { /* still more iterations? */ \
+        het_Integer idx_ = h_castU2S(h_castS2U(ivalue(s2v(ra))) + \
+                                     h_castS2U(ivalue(s2v(ra + 2)))); \
+        chgivalue(s2v(ra + 1), h_castU2S(count_ - 1)); \
+        chgivalue(s2v(ra), idx_); /* update internal index */ \
+        setivalue(s2v(ra + 3), idx_); /* and control variable */ \
+        pc -= GETARG_Bx(i); /* jump back */ \
+    } }
+
+#endif
@@ -0,0 +1,44 @@
+/*
+** Statistics about garbage-collector pauses
+*/
+#ifndef het_gcstats_h
+#define het_gcstats_h
+
+#include "het_limits.h"
+
+/*
+** The collector keeps one 'GCStats' in the global state. Each step is
+** timed with 'hetC_clock' and reported with 'hetC_recordstep'; the
+** pause of the current cycle is accumulated until the cycle ends and
+** is reported with 'hetC_recordcycle'. 'het_gc(L, HET_GCSTATS, ...)'
+** copies 'st' out (and may reset it with 'hetC_resetstats').
+*/
+typedef struct GCStats {
+    het_GCStats st; /* public part */
+    unsigned long cyclepause; /* pause accumulated in current cycle */
+} GCStats;
+
+/*
+** Time budget for 'het_gc(L, HET_GCSTEPTIME, us)'. The collector runs
+** single steps while 'hetC_budgetleft' is true; between steps is a
+** safe point. The clock is read before every step (steps are timed for
+** the statistics anyway), so the budget is overrun by one step at most.
+*/
+typedef struct GCBudget {
+    unsigned long start; /* when the budget was set */
+    unsigned long limit; /* budget, in microseconds */
+    int expired;
+} GCBudget;
+
+HETI_FUNC unsigned long hetC_clock(void);
+HETI_FUNC int hetC_histbucket(unsigned long us);
+HETI_FUNC void hetC_resetstats(GCStats *gs);
+HETI_FUNC void hetC_recordstep(GCStats *gs, unsigned long us,
+                               size_t traversed, size_t freed);
+HETI_FUNC void hetC_recordcycle(GCStats *gs);
+HETI_FUNC void hetC_budgetinit(GCBudget *b, unsigned long us);
+HETI_FUNC int hetC_budgetcheck(GCBudget *b);
+
+#define hetC_budgetleft(b) (!(b)->expired && hetC_budgetcheck(b))
+
+#endif
@@ -223,6 +223,12 @@ typedef h_uint32 Instruction;
 ** macros that are executed whenever program enters the Het core
 ** `het_lock` and leaves the code `het_unlock`
 */
+#if defined(HET_USE_STATELOCK) && !defined(het_lock)
+#define het_lock(L) hetE_lock(&G(L)->lock)
+#define het_unlock(L) hetE_unlock(&G(L)->lock)
+#define heti_threadyield(L) hetE_lockyield(&G(L)->lock)
+#endif
+
 #if !defined(het_lock)
 #define het_lock(L) ((void)0)
 #define het_unlock(L) ((void)0)
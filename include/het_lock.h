@@ -0,0 +1,63 @@
+/*
+** Lock of a shared state
+*/
+#ifndef het_lock_h
+#define het_lock_h
+
+#include "het.h"
+#include "het_limits.h"
+
+/*
+** With HET_USE_STATELOCK, 'het_lock' and 'het_unlock' take and release
+** the 'StateLock' of the global state, so any number of OS threads can
+** call the API on a shared state, one at a time. The lock is held while
+** Het code runs; at the points where 'heti_threadyield' runs, the
+** holder lets another thread in, but only if one is waiting (so a
+** single thread never releases it there).
+**
+** Taking a free lock is one compare-and-swap and releasing it is one
+** release store. A thread finding it taken spins for a while and then
+** yields the processor between tries; the wait is timed only then, so
+** uncontended use never reads the clock. Statistics are updated by the
+** holder, under the lock.
+*/
+
+#if defined(HET_USE_STATELOCK)
+
+#if !defined(__GNUC__)
+#error "HET_USE_STATELOCK needs GCC-style atomic builtins"
+#endif
+
+typedef struct StateLock {
+    int held; /* 1 if taken */
+    int nwaiting; /* threads waiting for the lock */
+    het_LockStats st;
+} StateLock;
+
+HETI_FUNC void hetE_initlock(StateLock *l);
+HETI_FUNC void hetE_lockslow(StateLock *l);
+HETI_FUNC void hetE_handoff(StateLock *l);
+HETI_FUNC void hetE_lockstats(StateLock *l, het_LockStats *st, int reset);
+
+h_sinline void hetE_lock(StateLock *l) {
+    int expected = 0;
+    if (h_likely(__atomic_compare_exchange_n(&l->held, &expected, 1, 0,
+                                             __ATOMIC_ACQUIRE,
+                                             __ATOMIC_RELAXED)))
+        l->st.acquires++;
+    else
+        hetE_lockslow(l);
+}
+
+h_sinline void hetE_unlock(StateLock *l) {
+    __atomic_store_n(&l->held, 0, __ATOMIC_RELEASE);
+}
+
+h_sinline void hetE_lockyield(StateLock *l) {
+    if (__atomic_load_n(&l->nwaiting, __ATOMIC_RELAXED) != 0)
+        hetE_handoff(l);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+/*
+** Read-only mapping of chunk files, for het_loadfixed
+*/
+#ifndef het_mapfile_h
+#define het_mapfile_h
+
+#include "het.h"
+
+/*
+** 'het_mapfile' maps file 'path' read-only into 'mf' and returns its
+** contents, or NULL on errors (see 'errno'). Mapped pages of the same
+** file are shared by all processes that map it. Where mapping is not
+** available (or fails) the file is read into memory instead.
+** 'het_unmapfile' releases the contents, after all states using them
+** were closed.
+*/
+typedef struct het_MappedFile {
+    const char *data;
+    size_t size;
+    int mapped; /* true if 'data' is a mapping (not a heap copy) */
+} het_MappedFile;
+
+HET_API const char *(het_mapfile)(het_MappedFile *mf, const char *path);
+HET_API void (het_unmapfile)(het_MappedFile *mf);
+
+#endif
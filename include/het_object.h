@@ -42,6 +42,8 @@ typedef union Value {
     he_byte ub;
 } Value;
 
+#if !defined(HET_NANBOXING)
+
 /*
  * Tagged Values. This is a basic representation of values in Het:
  * an actual value plus a tag with its type.
@@ -58,6 +60,58 @@ typedef struct TValue {
 /* raw type tag of a TValue */
 #define rawtt(o) ((o)->tt_)
 
+#else
+
+/*
+ * NaN-boxed Tagged Values (see HET_NANBOXING in het_conf.h). A TValue
+ * is a single 64-bit word. Floats are stored as themselves; any other
+ * value is stored in the payload of a negative quiet NaN, a pattern no
+ * float can have because NaNs are canonicalized when stored:
+ *
+ *   1 11111111111 1 kkkk ppp...ppp
+ *   s  exponent   q kind payload (47 bits)
+ *
+ * 'kind' (NBK_*) says how to read the payload: NBK_PLAIN keeps the full
+ * tag in bits 32-38 and, for integers, the value in bits 0-31; the
+ * other kinds hold a pointer, and the tag of a collectable value is
+ * read back from its object header.
+ */
+#include <stdint.h>
+
+#define TValueFields uint64_t nb_
+
+typedef struct TValue {
+    TValueFields;
+} TValue;
+
+#define NB_BOXED UINT64_C(0xFFF8000000000000)
+#define NB_CANONNAN UINT64_C(0x7FF8000000000000)
+#define NB_KINDSHIFT 47
+#define NB_PAYLOAD ((UINT64_C(1) << NB_KINDSHIFT) - 1)
+
+#define NBK_PLAIN 0 /* nil, booleans and integers */
+#define NBK_LIGHTUD 1 /* light userdata */
+#define NBK_LCF 2 /* light C functions */
+#define NBK_DEADKEY 3 /* removed keys in tables */
+#define NBK_GC 4 /* collectable objects */
+
+#define nbbox_(k,p) (NB_BOXED | (cast(uint64_t, k) << NB_KINDSHIFT) | (p))
+#define nbplain_(t) nbbox_(NBK_PLAIN, cast(uint64_t, t) << 32)
+#define nbp2w_(p) (cast(uint64_t, cast(H_P2I, p)) & NB_PAYLOAD)
+
+#define nbisboxed_(o) ((o)->nb_ >= NB_BOXED)
+#define nbkind_(o) cast_int(((o)->nb_ >> NB_KINDSHIFT) & 0xF)
+#define nbhigh_(o) cast(uint32_t, (o)->nb_ >> 32)
+#define nbptr_(o) cast_voidp(cast(H_P2I, (o)->nb_ & NB_PAYLOAD))
+
+/* decoded value and raw type tag of a TValue (see functions below) */
+#define val_(o) nbval_(o)
+#define valraw(o) (val_(o))
+
+#define rawtt(o) nbrawtt_(o)
+
+#endif
+
 /* tag with no variants (bits 0-3) */
 #define novariant(t) ((t) & 0x0F)
 
@@ -85,17 +139,46 @@ typedef struct TValue {
  */
 #define checkliveness(L, obj) \
     ((void)L, het_longassert(!iscollectable(obj) || \
-            (righttt(obj) && (L == NULL || !isdead(G(L),gcvalue(obj)))))
+            (righttt(obj) && (L == NULL || !isdead(G(L),gcvalue(obj))))))
 
 /* Macros to set values */
 
-/* set a value's tag */
+/*
+ * Primitive stores used by all the setters below; they are the only
+ * macros that depend on the layout of a TValue.
+ */
+#if !defined(HET_NANBOXING)
+
+/* set a value's tag (for values with no payload) */
 #define settt_(o,t) ((o)->tt_=(t))
 
+#define setgcoval_(o,x,t) (val_(o).gc=(x), settt_(o, t))
+#define setival_(o,x) (val_(o).i=(x), settt_(o, HET_VNUMINT))
+#define setfltval_(o,x) (val_(o).n=(x), settt_(o, HET_VNUMFLT))
+#define setpval_(o,x) (val_(o).p=(x), settt_(o, HET_VLIGHTUSERDATA))
+#define setfval_(o,x) (val_(o).f=(x), settt_(o, HET_VLCF))
+#define copyval_(o1,o2) ((o1)->value_=(o2)->value_, settt_(o1, (o2)->tt_))
+
+#else
+
+#define settt_(o,t) ((o)->nb_=nbplain_(t))
+
+/* the tag of a collectable value comes from the object itself */
+#define setgcoval_(o,x,t) \
+    (het_assert((t) == ctb((x)->tt)), (o)->nb_=nbbox_(NBK_GC, nbp2w_(x)))
+#define setival_(o,x) \
+    ((o)->nb_=nbplain_(HET_VNUMINT) | cast(uint32_t, (x)))
+#define setfltval_(o,x) ((o)->nb_=nbf2w_(x))
+#define setpval_(o,x) ((o)->nb_=nbbox_(NBK_LIGHTUD, nbp2w_(x)))
+#define setfval_(o,x) ((o)->nb_=nbbox_(NBK_LCF, nbp2w_(x)))
+#define copyval_(o1,o2) ((o1)->nb_=(o2)->nb_)
+
+#endif
+
 /* main macro to copy values (from 'obj2' to 'obj1') */
 #define setobj(L,obj1,obj2) \
     { TValue *io1 = (obj1); const TValue *io2 = (obj2); \
-      io1->value_ = io2->value_; settt_(io1, io2->tt_); \
+      copyval_(io1, io2); \
       checkliveness(L,io1); het_assert(!isnonstrictnil(io1)); }
 
 /*
@@ -180,7 +263,11 @@ typedef union {
 #define isempty(v) ttisnil(v)
 
 /* macro defining a value corresponding to an absent key */
+#if !defined(HET_NANBOXING)
 #define ABSTKEYCONSTANT {NULL},HET_VABSTKEY
+#else
+#define ABSTKEYCONSTANT nbplain_(HET_VABSTKEY)
+#endif
 
 /* mark an entry as empty */
 #define setempty(v) settt_(v, HET_VEMPTY)
@@ -212,7 +299,7 @@ typedef union {
 
 #define setthvalue(L,obj,x) \
     { TValue *io = (obj); het_State *x_ = (x); \
-      val_(io).gc = obj2gco(x_); settt_(io, ctb(HET_VTHREAD)); \
+      setgcoval_(io, obj2gco(x_), ctb(HET_VTHREAD)); \
       checkliveness(L,io); }
 
 #define setthvalue2s(L,o,t) setthvalue(L,s2v(o),t)
@@ -242,13 +329,13 @@ typedef struct GCObject {
 /* mark a tag as collectable */
 #define ctb(t) ((t) | BIT_ISCOLLECTABLE)
 
-#define gcvalue(o) (check_exp(iscollectable(o), val_(o).gc)
+#define gcvalue(o) check_exp(iscollectable(o), val_(o).gc)
 
 #define gcvalueraw(v) ((v).gc)
 
 #define setgcovalue(L,obj,x) \
     { TValue *io = (obj); GCObject *i_g=(x); \
-      val_(io).gc = i_g; settt_(io, ctb(i_g->tt)); }
+      setgcoval_(io, i_g, ctb(i_g->tt)); }
 
 /*
  * Numbers
@@ -271,16 +358,16 @@ typedef struct GCObject {
 #define ivalueraw(v) ((v).i)
 
 #define setfltvalue(obj,x) \
-    { TValue *io=(obj); val_(io).n=(x); settt_(io, HET_VNUMFLT); }
+    { TValue *io=(obj); setfltval_(io, x); }
 
 #define chgfltvalue(obj,x) \
-    { TValue *io=(obj); het_assert(ttisfloat(io)); val_(io).n =(x); }
+    { TValue *io=(obj); het_assert(ttisfloat(io)); setfltval_(io, x); }
 
 #define setivalue(obj,x) \
-{ TValue *io=(obj); val_(io).i=(x); settt_(io, HET_VNUMINT); }
+{ TValue *io=(obj); setival_(io, x); }
 
 #define chgivalue(obj,x) \
-{ TValue *io=(obj); het_assert(ttisinteger(io)); val_(io).i =(x); }
+{ TValue *io=(obj); het_assert(ttisinteger(io)); setival_(io, x); }
 
 /*
  * Strings
@@ -300,7 +387,7 @@ typedef struct GCObject {
 
 #define setsvalue(L,obj,x) \
     { TValue *io = (obj); TString *x_ = (x); \
-      val_(io).gc = obj2gco(x_); settt_(io, ctb(x_->tt)); \
+      setgcoval_(io, obj2gco(x_), ctb(x_->tt)); \
       checkliveness(L,io); }
 
 /* set a string to the stack */
@@ -356,11 +443,11 @@ typedef struct TString {
 #define pvalueraw(v) ((v).p)
 
 #define setpvalue(obj,x) \
-    { TValue *io=(obj); val_(io).p=(x); settt_(io,HET_VLIGHTUSERDATA); }
+    { TValue *io=(obj); setpval_(io, x); }
 
 #define setuvalue(L,obj,x) \
     { TValue *io = (obj); Udata *x_ = (x); \
-      val_(io).gc = obj2gco(x_); settt_(io, ctb(HET_VUSERDATA)); \
+      setgcoval_(io, obj2gco(x_), ctb(HET_VUSERDATA)); \
       checkliveness(L,io); }
 
 /* Ensures that addresses after this type are always fully assigned */
@@ -450,6 +537,45 @@ typedef struct AbsLineInfo {
     int line;
 } AbsLineInfo;
 
+/*
+ * Inline cache of an instruction that indexes a table with a constant
+ * short string (OP_GETTABUP, OP_GETFIELD, OP_SETTABUP, OP_SETFIELD and
+ * OP_SELF): the index of the node where the key was last found. An
+ * entry is only a hint, checked against the key at each use (see
+ * `hetH_icget`), so it stays safe across rehashes and when the same
+ * instruction sees tables of different shapes. With HET_USE_TABLESITES,
+ * the entry of an OP_NEWTABLE holds the sizes its tables grew to (which
+ * doubles the size of every entry, so it exists only with that option).
+ */
+typedef struct TableSite {
+    unsigned int asize; /* array size of the last table grown */
+    unsigned int hsize; /* hash size of the last table grown */
+} TableSite;
+
+typedef union ICache {
+    unsigned int node; /* node index of the last hit */
+#if defined(HET_USE_TABLESITES)
+    TableSite site; /* OP_NEWTABLE: sizes seen (see `hetH_sitesizes`) */
+#endif
+} ICache;
+
+/*
+ * Flags in Proto
+ */
+
+/*
+ * `code`, `lineinfo` and `abslineinfo` point into memory owned by
+ * someone else (a mapped or read-only chunk, see `het_loadfixed`): they
+ * must not be freed nor written to.
+ */
+#define PF_FIXED 1
+
+/*
+ * Some sample of the sampling profiler has a frame of this prototype
+ * (see `hetG_samplefree`).
+ */
+#define PF_SAMPLED 2
+
 /*
  * Function Prototypes
  */
@@ -457,6 +583,7 @@ typedef struct Proto {
     CommonHeader;
     he_byte numparams; /* number of fixed (named) parameters */
     he_byte is_vararg;
+    he_byte flag; /* PF_* flags */
     he_byte maxstacksize; /* number of registers needed by this function */
     int sizeupvalues; /* size of upvalues */
     int sizek; /* size of `k` */
@@ -469,6 +596,10 @@ typedef struct Proto {
     int lastlinedefined; /* debug information */
     TValue *k; /* constants used by the function */
     Instruction *code; /* opcodes */
+    ICache *icache; /* inline caches, parallel to `code` (or NULL) */
+#if defined(HET_USE_OPPROFILE)
+    unsigned long *opcount; /* executions, parallel to `code` (or NULL) */
+#endif
     struct Proto **p; /* functions defined inside the function */
     Upvaldesc *upvalues; /* upvalue information */
     hs_byte *lineinfo; /* information about source lines (debug information) */
@@ -505,17 +636,17 @@ typedef struct Proto {
 
 #define setclHvalue(L,obj,x) \
     { TValue *io = (obj); HClosure *x_ = (x); \
-      val_(io).gc = obj2gco(x_); settt_(io, ctb(HET_VLCL)); \
+      setgcoval_(io, obj2gco(x_), ctb(HET_VLCL)); \
       checkliveness(L,io); }
 
 #define setclHvalue2s(L,o,cl) setclHvalue(L,s2v(o),cl)
 
 #define setfvalue(obj,x) \
-    { TValue *io=(obj); val_(io).f=(x); settt_(io, HET_VLCF); }
+    { TValue *io=(obj); setfval_(io, x); }
 
 #define setclCvalue(L,obj,x) \
     { TValue *io = (obj); CClosure *x_ = (x); \
-      val_(io).gc = obj2gco(x_); settt_(io, ctb(HET_VCCL)); \
+      setgcoval_(io, obj2gco(x_), ctb(HET_VCCL)); \
       checkliveness(L,io); }
 
 /*
@@ -570,7 +701,7 @@ typedef union Closure {
 
 #define sethvalue(L,obj,x) \
     { TValue *io = (obj); Table *x_ = (x); \
-      val_(io).gc = obj2gco(x_); settt_(io, ctb(HET_VTABLE)); \
+      setgcoval_(io, obj2gco(x_), ctb(HET_VTABLE)); \
       checkliveness(L,io); }
 
 #define sethvalue2s(L,o,h) sethvalue(L,s2v(o),h)
@@ -580,18 +711,48 @@ typedef union Closure {
  * plus a `next` field to link colliding entries. The distribution
  * of the keys fields (key_tt and key_val) not forming a proper
  * TValue allows for a smaller size for Node both in 4-byte
- * and 8-byte alignments.
- */
+ * and 8-byte alignments. (With NaN-boxing a key is already a single
+ * word, so it is kept as a proper `TValue`.)
+ */
+#if !defined(HET_NANBOXING)
+#define NodeKeyFields \
+    he_byte key_tt; /* type of key */ \
+    int next; /* for chaining */ \
+    Value key_val /* key value */
+#else
+#define NodeKeyFields \
+    int next; /* for chaining */ \
+    TValue key_ /* key value and type */
+#endif
+
+#if !defined(HET_SPLITNODES)
+
 typedef struct Node {
     struct NodeKey {
         TValueFields; /* fields for value */
-        he_byte key_tt; /* type of key */
-        int next; /* for chaining */
-        Value key_val; /* key value */
+        NodeKeyFields;
     } u;
     TValue i_val; /* direct access to node's value as a proper `TValue` */
 } Node;
 
+#else
+
+/*
+ * Split layout (see HET_SPLITNODES in het_conf.h): a Node holds only
+ * the key and the chain link; values live in the parallel array
+ * `Table.nodeval`, so probing a chain touches only key bytes. Use
+ * `gval` (het_table.h) to get the value of a node.
+ */
+typedef struct Node {
+    struct NodeKey {
+        NodeKeyFields;
+    } u;
+} Node;
+
+#endif
+
+#if !defined(HET_NANBOXING)
+
 /* copy a value into a key */
 #define setnodekey(L,node,obj) \
     { Node *n_=(node); const TValue *io_(obj); \
@@ -604,6 +765,18 @@ typedef struct Node {
       io_->value_ = n_->u.key_val; io_->tt_ = n_->u.key_tt; \
       checkliveness(L,io_); }
 
+#else
+
+#define setnodekey(L,node,obj) \
+    { Node *n_=(node); const TValue *io_=(obj); \
+      n_->u.key_ = *io_; checkliveness(L,io_); }
+
+#define getnodekey(L,obj,node) \
+    { TValue *io_=(obj); const Node *n_=(node); \
+      *io_ = n_->u.key_; checkliveness(L,io_); }
+
+#endif
+
 /*
  * About `alimit`: if `isrealsize(t)` is true, then `alimit` is the
  * real size of `array`. Otherwise, thre real size of `array` is the
@@ -619,10 +792,25 @@ typedef struct Table {
     CommonHeader;
     he_byte flags; /* 1<<p means tagmethod(p) is not present */
     he_byte lsizenode; /* log2 of size of `node` array */
+#if defined(HET_USE_TYPEDARRAYS) /* (these two grow a table by 8 bytes) */
+    he_byte atype; /* representation of `array` (ATYPE_*) */
+#endif
     unsigned int alimit; /* "limit" of `array` array */
+#if defined(HET_USE_TYPEDARRAYS)
+    unsigned int tlen; /* number of elements of a typed `array` */
+#endif
     TValue *array; /* array part */
     Node *node;
+#if defined(HET_SPLITNODES)
+    TValue *nodeval; /* values of the hash part, parallel to `node` */
+#endif
+#if defined(HET_USE_CTRLBYTES)
+    he_byte *ctrl; /* control bytes of the hash part (see het_ctrl.h) */
+#endif
     Node *lastfree; /* any free position is before this position */
+#if defined(HET_USE_TABLESITES)
+    TableSite *site; /* creation site, until first traversal (or NULL) */
+#endif
     struct Table *metatable;
     GCObject *gclist;
 } Table;
@@ -630,8 +818,13 @@ typedef struct Table {
 /*
  * Macros to manipulate keys inserted in nodes
  */
+#if !defined(HET_NANBOXING)
 #define keytt(node) ((node)->u.key_tt)
 #define keyval(node) ((node)->u.key_val)
+#else
+#define keytt(node) rawtt(&(node)->u.key_)
+#define keyval(node) val_(&(node)->u.key_)
+#endif
 
 #define keyisnil(node) (keytt(node) == HET_TNIL)
 #define keyisinteger(node) (keytt(node) == HET_VNUMINT)
@@ -639,7 +832,17 @@ typedef struct Table {
 #define keyisshrstr(node) (keytt(node) == ctb(HET_VSHRSTR))
 #define keystrval(node) (gco2ts(keyval(node).gc))
 
+#if !defined(HET_NANBOXING)
 #define setnilkey(node) (keytt(node) == HET_TNIL)
+#define setdeadkey(node) (keytt(node) = HET_TDEADKEY)
+#else
+#define setnilkey(node) settt_(&(node)->u.key_, HET_TNIL)
+/* a dead key keeps its pointer, so that 'next' can still find it */
+#define setdeadkey(node) \
+    ((node)->u.key_.nb_ = nbbox_(NBK_DEADKEY, (node)->u.key_.nb_ & NB_PAYLOAD))
+#endif
+
+#define keyisdead(node) (keytt(node) == HET_TDEADKEY)
 
 #define keyiscollectable(n) (keytt(n) & BIT_ISCOLLECTABLE)
 
@@ -655,6 +858,89 @@ typedef struct Table {
 #define twoto(x) (1<<(x))
 #define sizenode(t) (twoto((t)->lsizenode))
 
+#if defined(HET_NANBOXING)
+
+/*
+ * Decoding of NaN-boxed values. 'nbrawtt_' and 'nbval_' rebuild the
+ * tag and the 'Value' of the unboxed representation, so that all the
+ * accessors above work unchanged; the most frequent tests are then
+ * redefined to look only at the word.
+ */
+
+/* canonicalize NaNs, so that no float looks like a boxed value */
+h_sinline uint64_t nbf2w_(het_Number n) {
+    union { het_Number n; uint64_t w; } u;
+    if (n != n) /* NaN? */
+        return NB_CANONNAN;
+    u.n = n;
+    return u.w;
+}
+
+h_sinline he_byte nbrawtt_(const TValue *o) {
+    if (!nbisboxed_(o))
+        return HET_VNUMFLT;
+    switch (nbkind_(o)) {
+        case NBK_PLAIN: return cast_byte(nbhigh_(o) & 0x7F);
+        case NBK_LIGHTUD: return HET_VLIGHTUSERDATA;
+        case NBK_LCF: return HET_VLCF;
+        case NBK_DEADKEY: return HET_TDEADKEY;
+        default: return ctb(cast(GCObject *, nbptr_(o))->tt);
+    }
+}
+
+h_sinline Value nbval_(const TValue *o) {
+    Value v;
+    if (!nbisboxed_(o)) {
+        union { uint64_t w; het_Number n; } u;
+        u.w = o->nb_;
+        v.n = u.n;
+    }
+    else switch (nbkind_(o)) {
+        case NBK_PLAIN: v.i = cast(int32_t, cast(uint32_t, o->nb_)); break;
+        case NBK_LIGHTUD: v.p = nbptr_(o); break;
+        case NBK_LCF:
+            v.f = cast(het_CFunction, cast(H_P2I, o->nb_ & NB_PAYLOAD));
+            break;
+        default: v.gc = cast(GCObject *, nbptr_(o)); break;
+    }
+    return v;
+}
+
+#undef iscollectable
+#define iscollectable(o) (nbisboxed_(o) && nbkind_(o) == NBK_GC)
+
+#undef ttisnil
+#define ttisnil(o) ((nbhigh_(o) & ~0x30u) == (nbplain_(HET_TNIL) >> 32))
+
+#undef ttisboolean
+#define ttisboolean(o) \
+    ((nbhigh_(o) & ~0x30u) == (nbplain_(HET_TBOOLEAN) >> 32))
+
+#undef ttisfalse
+#define ttisfalse(o) ((o)->nb_ == nbplain_(HET_VFALSE))
+
+#undef ttistrue
+#define ttistrue(o) ((o)->nb_ == nbplain_(HET_VTRUE))
+
+#undef ttisinteger
+#define ttisinteger(o) (nbhigh_(o) == (nbplain_(HET_VNUMINT) >> 32))
+
+#undef ttisfloat
+#define ttisfloat(o) (!nbisboxed_(o))
+
+#undef ttisnumber
+#define ttisnumber(o) (ttisfloat(o) || ttisinteger(o))
+
+#undef fltvalue
+#define fltvalue(o) check_exp(ttisfloat(o), nbval_(o).n)
+
+#undef ivalue
+#define ivalue(o) \
+    check_exp(ttisinteger(o), \
+             cast(het_Integer, cast(int32_t, cast(uint32_t, (o)->nb_))))
+
+#endif
+
 /* size of buffer for `het0_utf8esc` function */
 #define UTF8BUFFSZ 8
 
@@ -288,6 +288,27 @@ typedef enum
 
   OP_VARARGPREP, /*A       (adjust vararg parameters)                      */
 
+  OP_GETFIELDCALL, /* A B C   R[A] := R[B][K[C]:shortstring]; then the
+                              OP_CALL that follows     (*)             */
+
+  /* specialized arithmetic (see note)                                   */
+  OP_ADDIINT, /* A B sC  R[A] := R[B] + sC         (R[B] integer) */
+  OP_ADDIFLT, /* A B sC  R[A] := R[B] + sC         (R[B] float) */
+  OP_ADDKINT, /* A B C   R[A] := R[B] + K[C]       (both integers) */
+  OP_ADDKFLT, /* A B C   R[A] := R[B] + K[C]       (both floats) */
+  OP_SUBKINT, /* A B C   R[A] := R[B] - K[C]       (both integers) */
+  OP_SUBKFLT, /* A B C   R[A] := R[B] - K[C]       (both floats) */
+  OP_MULKINT, /* A B C   R[A] := R[B] * K[C]       (both integers) */
+  OP_MULKFLT, /* A B C   R[A] := R[B] * K[C]       (both floats) */
+  OP_ADDINT, /* A B C   R[A] := R[B] + R[C]       (both integers) */
+  OP_ADDFLT, /* A B C   R[A] := R[B] + R[C]       (both floats) */
+  OP_SUBINT, /* A B C   R[A] := R[B] - R[C]       (both integers) */
+  OP_SUBFLT, /* A B C   R[A] := R[B] - R[C]       (both floats) */
+  OP_MULINT, /* A B C   R[A] := R[B] * R[C]       (both integers) */
+  OP_MULFLT, /* A B C   R[A] := R[B] * R[C]       (both floats) */
+
+  OP_FORLOOPI, /*  A Bx    OP_FORLOOP of an integer loop            (*)     */
+
   OP_EXTRAARG /*   Ax      extra (larger) argument for previous opcode     */
 } OpCode;
 
@@ -344,6 +365,30 @@ typedef enum
   original operand was a float. (It must be corrected in case of
   metamethods.)
 
+  (*) OP_GETFIELDCALL is a superinstruction, written over an OP_GETFIELD
+  by 'hetP_fuse' when the next instruction is an OP_CALL of the same
+  register. It does the OP_GETFIELD and then executes that OP_CALL
+  without dispatching it. The OP_CALL stays in the code, so jumps to it
+  and all code that looks at single instructions still work; code that
+  needs the original opcode uses 'baseopcode'. Pairs like OP_LT+OP_JMP
+  and OP_ADD+OP_MMBIN are not fused: their fast paths already consume
+  the second instruction without dispatching it.
+
+  (*) The specialized arithmetic opcodes (OP_ADDIINT to OP_MULFLT) are
+  never generated by the compiler. The interpreter writes one over a
+  generic OP_ADDI, OP_ADDK, OP_SUBK, OP_MULK, OP_ADD, OP_SUB or OP_MUL
+  after it runs on two integers or two floats (quickening, see
+  'het_quicken.h'), and writes the generic opcode back, with k set, when
+  the specialized one sees other operands; k keeps that instruction
+  generic from then on. Like the generic opcodes, they skip the
+  OP_MMBIN* that follows.
+
+  (*) OP_FORLOOPI is OP_FORLOOP for loops known to be integer loops when
+  compiled (the initial value and the step are integer constants; see
+  'het_forloop.h'): it decrements the iteration count precomputed by
+  OP_FORPREP and updates the control variable, with no type, overflow or
+  float checks.
+
 ===========================================================================*/
 
 /*
@@ -365,6 +410,14 @@ HETI_DDEC(const he_byte hetP_opmodes[NUM_OPCODES];)
 #define testOTMode(m) (hetP_opmodes[m] & (1 << 6))
 #define testMMMode(m) (hetP_opmodes[m] & (1 << 7))
 
+/*
+** original opcode of each opcode (itself, except for superinstructions,
+** which must be undone e.g. when dumping or describing code)
+*/
+HETI_DDEC(const he_byte hetP_opbase[NUM_OPCODES];)
+
+#define baseopcode(o) (cast(OpCode, hetP_opbase[o]))
+
 /* "out top" (set top for next instruction) */
 #define isOT(i)                                       \
   ((testOTMode(GET_OPCODE(i)) && GETARG_C(i) == 0) || \
@@ -0,0 +1,35 @@
+/*
+** Instruction execution counts (instrumented builds)
+*/
+#ifndef het_opprof_h
+#define het_opprof_h
+
+#include "het.h"
+#include "het_object.h"
+
+/*
+** With HET_USE_OPPROFILE, each prototype has an 'opcount' array parallel
+** to its code, created by 'hetG_newopcount' when the function first runs
+** and freed with the prototype by 'hetG_freeopcount'. The interpreter
+** uses 'hetG_countop' right after fetching each instruction ('pc' points
+** to the next one). Totals per opcode are added up from these arrays
+** when dumping, so they only cover functions still alive.
+*/
+#if defined(HET_USE_OPPROFILE)
+
+#define hetG_countop(p, pc) \
+    { if ((p)->opcount != NULL) (p)->opcount[(pc) - 1 - (p)->code]++; }
+
+HETI_FUNC void hetG_newopcount(Proto *p);
+HETI_FUNC void hetG_freeopcount(Proto *p);
+HETI_FUNC void hetG_resetopcount(Proto *p);
+HETI_FUNC int hetG_dumpopcount(het_State *L, const Proto *p, int nhot,
+                               het_Writer w, void *ud);
+
+#else
+
+#define hetG_countop(p, pc) ((void)0)
+
+#endif
+
+#endif
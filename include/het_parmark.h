@@ -0,0 +1,85 @@
+/*
+** Parallel mark phase
+*/
+#ifndef het_parmark_h
+#define het_parmark_h
+
+#include "het.h"
+#include "het_object.h"
+
+/*
+** With HET_USE_PARMARK, a full (stop-the-world) collection can run its
+** mark phase on several threads. Each worker owns a gray deque: it
+** pushes and takes objects at one end, and idle workers steal from the
+** other end of the others' deques (Chase-Lev deques, so the owner's
+** operations need no locks). A worker claims a white object by
+** clearing its white bits with a compare-and-swap, so each object is
+** traversed once, by the worker that claimed it.
+**
+** The collector gives a traversal function that marks the children of
+** an object with 'hetC_pmmark' (and changes other bits of 'marked'
+** only with atomic operations, as other workers may be testing them).
+** Objects that the parallel phase cannot handle (threads, weak tables
+** and ephemerons, whose traversal depends on the rest of the mark) are
+** claimed but linked, through their 'gclist' fields, in the worker's
+** 'deferred' list, which the serial atomic phase takes over; this needs
+** no allocation. Deques are
+** allocated outside the state allocator, as a collection must not
+** allocate from it.
+**
+** A collection does 'hetC_pminit', marks the roots with 'hetC_pmroot',
+** runs 'hetC_parmark' and then splices the deferred lists before
+** 'hetC_pmfree'.
+*/
+
+#if defined(HET_USE_PARMARK)
+
+#if !defined(__GNUC__)
+#error "HET_USE_PARMARK needs GCC-style atomic builtins"
+#endif
+
+typedef struct ParMark ParMark;
+
+/* traverse 'o' for worker 'w'; returns the number of bytes traversed */
+typedef size_t (*ParTraverse)(ParMark *pm, int w, GCObject *o);
+
+typedef struct GrayArray {
+    struct GrayArray *old; /* previous (smaller) array, freed at the end */
+    long size; /* power of 2 */
+    GCObject *item[1];
+} GrayArray;
+
+typedef struct GrayWorker {
+    long top; /* next slot to steal */
+    long bottom; /* next slot to push */
+    GrayArray *a;
+    GCObject *deferred; /* objects left to the serial phase */
+    size_t traversed;
+    char pad[64]; /* keep workers in different cache lines */
+} GrayWorker;
+
+struct ParMark {
+    GrayWorker *wk;
+    int n; /* number of workers */
+    int nstarted; /* workers that have started */
+    int nidle; /* started workers out of work */
+    int nextroot; /* worker getting the next root */
+    he_byte whites; /* bits that mark an object as white */
+    ParTraverse traverse;
+    void *ud; /* for the traversal function */
+};
+
+HETI_FUNC int hetC_pminit(ParMark *pm, int n, he_byte whites,
+                          ParTraverse traverse, void *ud);
+HETI_FUNC void hetC_pmfree(ParMark *pm);
+HETI_FUNC void hetC_pmmark(ParMark *pm, int w, GCObject *o);
+HETI_FUNC void hetC_pmroot(ParMark *pm, GCObject *o);
+HETI_FUNC size_t hetC_parmark(ParMark *pm, het_GCRunner f, void *ud);
+HETI_FUNC void hetC_runthreads(void *ud, void (*work)(void *arg), void *arg,
+                               int n);
+
+#define hetC_pmdeferred(pm, w) (&(pm)->wk[w].deferred)
+
+#endif
+
+#endif
@@ -0,0 +1,24 @@
+/*
+** Peephole pass over finished prototypes
+*/
+#ifndef het_peephole_h
+#define het_peephole_h
+
+#include "het_object.h"
+#include "het_opcodes.h"
+
+/*
+** 'hetP_fuse' rewrites pairs of instructions of 'f' and of its nested
+** functions into superinstructions (see OP_GETFIELDCALL) and adds to
+** 'st' (when not NULL) how many instructions it looked at and how many
+** it fused. Each executed superinstruction saves one dispatch. Code of
+** fixed prototypes (PF_FIXED) is read-only and is left alone.
+*/
+typedef struct FuseStats {
+    unsigned long ninstr; /* instructions examined */
+    unsigned long nfused; /* superinstructions written */
+} FuseStats;
+
+HETI_FUNC void hetP_fuse(Proto *f, FuseStats *st);
+
+#endif
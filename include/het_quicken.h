@@ -0,0 +1,95 @@
+/*
+** Quickening of arithmetic instructions
+*/
+#ifndef het_quicken_h
+#define het_quicken_h
+
+#include "het_object.h"
+#include "het_opcodes.h"
+
+/*
+** A generic arithmetic instruction that just computed its result from
+** two integers or two floats rewrites itself (the instruction before
+** 'pc') into the specialized opcode for those types, which checks its
+** operands with a single test and has no conversions. The first miss
+** writes the generic opcode back with k set, and k stops any further
+** quickening of that instruction, so a polymorphic site settles as
+** generic after one round trip. Code of fixed prototypes is read-only
+** and is never quickened.
+**
+** Macros here are for the interpreter loop, which defines 'pc', 'i'
+** and 'ra' as usual. Code that saves or shows instructions should use
+** 'baseopcode' and ignore k of arithmetic opcodes.
+*/
+
+/* specialized version of generic opcode 'op' (or 'op' itself) */
+h_sinline OpCode hetV_quickop(OpCode op, int isflt) {
+    switch (op) {
+        case OP_ADDI: return isflt ? OP_ADDIFLT : OP_ADDIINT;
+        case OP_ADDK: return isflt ? OP_ADDKFLT : OP_ADDKINT;
+        case OP_SUBK: return isflt ? OP_SUBKFLT : OP_SUBKINT;
+        case OP_MULK: return isflt ? OP_MULKFLT : OP_MULKINT;
+        case OP_ADD: return isflt ? OP_ADDFLT : OP_ADDINT;
+        case OP_SUB: return isflt ? OP_SUBFLT : OP_SUBINT;
+        case OP_MUL: return isflt ? OP_MULFLT : OP_MULINT;
+        default: return op;
+    }
+}
+
+/* instruction being executed, for rewriting */
+#define curinstr(pc) (*cast(Instruction *, (pc) - 1))
+
+/*
+** called by a generic opcode after its integer or float fast path, which
+** has already skipped the OP_MMBIN* ('pc' is one instruction ahead)
+*/
+#define hetV_quicken(p, pc, i, isflt) \
+    { if (!GETARG_k(i) && !((p)->flag & PF_FIXED)) \
+        SET_OPCODE(curinstr((pc) - 1), hetV_quickop(GET_OPCODE(i), isflt)); }
+
+/* called by a specialized opcode on a type miss ('i' is updated too) */
+#define hetV_dequicken(pc, i) \
+    { SET_OPCODE(i, baseopcode(GET_OPCODE(i))); SETARG_k(i, 1); \
+      curinstr(pc) = (i); }
+
+/*
+** Bodies of the specialized opcodes: compute R[A] from 'v1' and 'v2'
+** (an immediate for the 'I' forms) and skip the following OP_MMBIN*,
+** or de-quicken and run 'generic', which must go on as the generic
+** opcode.
+*/
+#define hetV_quickint(op, v1, v2, generic) { \
+    const TValue *v1_ = (v1); const TValue *v2_ = (v2); \
+    if (h_likely(ttisinteger(v1_) && ttisinteger(v2_))) { \
+        pc++; \
+        setivalue(s2v(ra), h_castU2S(h_castS2U(ivalue(v1_)) op \
+                                     h_castS2U(ivalue(v2_)))); \
+    } \
+    else { hetV_dequicken(pc, i); generic; } }
+
+#define hetV_quickflt(L, fop, v1, v2, generic) { \
+    const TValue *v1_ = (v1); const TValue *v2_ = (v2); \
+    if (h_likely(ttisfloat(v1_) && ttisfloat(v2_))) { \
+        pc++; \
+        setfltvalue(s2v(ra), fop(L, fltvalue(v1_), fltvalue(v2_))); \
+    } \
+    else { hetV_dequicken(pc, i); generic; } }
+
+#define hetV_quickintI(op, v1, imm, generic) { \
+    const TValue *v1_ = (v1); \
+    if (h_likely(ttisinteger(v1_))) { \
+        pc++; \
+        setivalue(s2v(ra), h_castU2S(h_castS2U(ivalue(v1_)) op \
+                                     h_castS2U(imm))); \
+    } \
+    else { hetV_dequicken(pc, i); generic; } }
+
+#define hetV_quickfltI(L, fop, v1, imm, generic) { \
+    const TValue *v1_ = (v1); \
+    if (h_likely(ttisfloat(v1_))) { \
+        pc++; \
+        setfltvalue(s2v(ra), fop(L, fltvalue(v1_), cast_num(imm))); \
+    } \
+    else { hetV_dequicken(pc, i); generic; } }
+
+#endif
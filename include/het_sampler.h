@@ -0,0 +1,81 @@
+/*
+** Sampling profiler
+*/
+#ifndef het_sampler_h
+#define het_sampler_h
+
+#include "het.h"
+#include "het_object.h"
+
+/*
+** A sampler records call stacks into a ring of slots allocated when it
+** is created, so taking a sample never allocates nor touches strings.
+** Each sample is a header slot (its number of frames) followed by one
+** slot per frame, innermost first; a frame is a prototype and the pc
+** of its current instruction (NULL for C functions). When the ring is
+** full, the oldest samples are dropped.
+**
+** The interpreter calls 'hetG_sampletick' where it counts instructions
+** for hooks; every 'period' ticks the sampler is due, and if it has an
+** 'interval' it is due only when that many microseconds have passed
+** since the last sample (so the clock is read once per 'period' ticks).
+** When due, the caller walks its CallInfo list with
+** 'hetG_samplebegin'/'hetG_sampleframe'/'hetG_sampleend'.
+**
+** Samples hold no references. Recording a frame flags its prototype
+** with PF_SAMPLED, and the collector calls 'hetG_samplefree' for every
+** prototype it frees, so frames of prototypes collected before the
+** dump are written as "[collected]" (and a new prototype at the same
+** address is not mistaken for them).
+**
+** This is the internal side only: the state that owns the sampler, its
+** calls from the interpreter and the collector, and the public entry
+** points to start, stop and dump it belong to the state and API
+** modules.
+*/
+
+/* maximum number of frames recorded per sample (outer ones are cut) */
+#if !defined(HET_SAMPLEDEPTH)
+#define HET_SAMPLEDEPTH 64
+#endif
+
+typedef union SampleSlot {
+    unsigned int n; /* header: number of frames that follow */
+    struct {
+        const Proto *p; /* NULL for a C function */
+        int pc;
+    } f;
+} SampleSlot;
+
+typedef struct Sampler {
+    SampleSlot *ring;
+    unsigned int size; /* number of slots (power of 2) */
+    unsigned int head; /* header of oldest sample */
+    unsigned int tail; /* next free slot */
+    unsigned int cur; /* header of sample being recorded */
+    int period; /* ticks between checks */
+    int countdown; /* ticks until next check */
+    unsigned long interval; /* microseconds between samples (or 0) */
+    unsigned long last; /* time of last sample */
+    unsigned long nsamples; /* samples taken */
+    unsigned long ndropped; /* samples overwritten in the ring */
+} Sampler;
+
+#define hetG_sampletick(s) (--(s)->countdown <= 0 && hetG_sampledue(s))
+
+/* called by the collector before freeing 'p' ('s' may be NULL) */
+#define hetG_samplefree(s, p) \
+    { if ((s) != NULL && ((p)->flag & PF_SAMPLED)) hetG_sampleforget(s, p); }
+
+HETI_FUNC Sampler *hetG_newsampler(unsigned int nslots, int period,
+                                   unsigned long interval);
+HETI_FUNC void hetG_freesampler(Sampler *s);
+HETI_FUNC int hetG_sampledue(Sampler *s);
+HETI_FUNC void hetG_samplebegin(Sampler *s);
+HETI_FUNC void hetG_sampleframe(Sampler *s, Proto *p, int pc);
+HETI_FUNC void hetG_sampleforget(Sampler *s, const Proto *p);
+HETI_FUNC void hetG_sampleend(Sampler *s);
+HETI_FUNC int hetG_dumpsamples(het_State *L, Sampler *s, int lines,
+                               het_Writer w, void *ud);
+
+#endif
@@ -0,0 +1,42 @@
+/*
+** String table (keeps all strings handled by Het)
+*/
+#ifndef het_string_h
+#define het_string_h
+
+#include "het_object.h"
+
+/* size of a TString holding 'l' characters */
+#define sizelstring(l) (offsetof(TString, contents) + ((l) + 1) * sizeof(char))
+
+/* test whether a string is a reserved word */
+#define isreserved(s) ((s)->tt == HET_VSHRSTR && (s)->extra > 0)
+
+/* equality for short strings, which are always internalized */
+#define eqshrstr(a,b) check_exp((a)->tt == HET_VSHRSTR, (a) == (b))
+
+HETI_FUNC unsigned int hetS_hash(const char *str, size_t l, unsigned int seed);
+
+/*
+** Shared pool of short strings (see het_string.c). Pool strings are
+** never collected; a state uses the pool only if it hashes its strings
+** with the seed given by 'hetS_usepool', which seals the pool: a string
+** added afterwards could already be interned in a state, which would
+** then have two strings with the same contents. Pool strings are shared
+** by threads of several states and must never be written: reserved
+** words enter the pool with their 'extra' already set, and the lexer
+** must not set it on a pool string ('isshared').
+**
+** Pool strings have SHAREDBIT set in 'marked' (the collector uses only
+** bits 0 to 6) and no white or black bit, so collectors never mark or
+** free them.
+*/
+#define SHAREDBIT 7
+#define isshared(s) ((s)->marked & (1 << SHAREDBIT))
+
+HETI_FUNC unsigned int hetS_usepool(void);
+HETI_FUNC TString *hetS_sharedlookup(const char *str, size_t l,
+                                     unsigned int h);
+HETI_FUNC TString *hetS_newshared(const char *str, size_t l, int extra);
+
+#endif
@@ -0,0 +1,230 @@
+/*
+** Het tables (hash)
+*/
+#ifndef het_table_h
+#define het_table_h
+
+#include "het_object.h"
+
+#define gnode(t,i) (&(t)->node[i])
+#define gnext(n) ((n)->u.next)
+
+/*
+** 'gval' gives the value stored with node 'n' of table 't', and
+** 'nodefromval' goes back from such a value to its node. Lookup code
+** must use them (and the key accessors from het_object.h) instead of
+** touching 'Node' fields, so that it works with both hash layouts.
+*/
+#if !defined(HET_SPLITNODES)
+#define gval(t,n) ((void)(t), &(n)->i_val)
+#define nodefromval(t,v) \
+    ((void)(t), cast(Node *, cast_charp(v) - offsetof(Node, i_val)))
+#else
+#define gval(t,n) (&(t)->nodeval[(n) - (t)->node])
+#define nodefromval(t,v) (&(t)->node[cast(const TValue *, (v)) - (t)->nodeval])
+#endif
+
+/*
+** Clears all bits of fast-access metamethods, which means that the table
+** may have any of these metamethods. (First access that fails after the
+** clearing will set the bit again.)
+*/
+#define invalidateTMcache(t) ((t)->flags &= ~maskflags)
+
+/* true when 't' is using 'dummynode' as its hash part */
+#define isdummy(t) ((t)->lastfree == NULL)
+
+/* allocated size for hash nodes */
+#define allocsizenode(t) (isdummy(t) ? 0 : sizenode(t))
+
+/*
+** Inline caches for constant short-string keys (see 'ICache'). The
+** cached node is used only if it still holds the same key, so a stale
+** entry (after a rehash, or for another table) just misses; the
+** instruction then does a regular lookup and refills the entry with
+** 'hetH_icupdate'.
+*/
+h_sinline const TValue *hetH_icget(const Table *t, const ICache *ic,
+                                   const TString *key) {
+    unsigned int i = ic->node;
+    if (i < cast_uint(sizenode(t))) {
+        const Node *n = gnode(t, i);
+        if (keyisshrstr(n) && gckey(n) == cast(const GCObject *, key))
+            return gval(t, n);
+    }
+    return NULL;
+}
+
+/* remember the node of 'slot', a result of a hash-part lookup in 't' */
+#define hetH_icupdate(t,ic,slot) \
+    { if (!isabstkey(slot)) \
+        (ic)->node = cast_uint(nodefromval(t, slot) - (t)->node); }
+
+/*
+** {======================================================
+** Allocation-site size hints
+** =======================================================
+*/
+
+/*
+** With HET_USE_TABLESITES, OP_NEWTABLE creates its table with
+** 'hetH_sitesizes' (the sizes it asks for, raised to those recorded in
+** its 'TableSite') and links the table to the site with 'hetH_setsite'.
+** Every resize of a linked table records the new sizes in the site, so
+** the site learns the final sizes of the tables it creates.
+**
+** Sites live in their prototypes, which may be collected before the
+** tables. So the collector unlinks a table ('hetH_clearsite') whenever
+** it traverses it: a prototype is only freed after a cycle in which it
+** was not reached, and any live table created by it was traversed in
+** that same cycle. Tables that keep growing after that no longer teach
+** their site, which is fine for the short-lived tables this is for.
+*/
+#if defined(HET_USE_TABLESITES)
+
+/* maximum sizes hinted, so that one huge table does not bloat others */
+#if !defined(HET_MAXSITEHINT)
+#define HET_MAXSITEHINT (1u << 16)
+#endif
+
+#define hetH_sitesizes(s, nasize, nhsize) \
+    { if ((s)->asize > (nasize)) (nasize) = (s)->asize; \
+      if ((s)->hsize > (nhsize)) (nhsize) = (s)->hsize; }
+
+#define hetH_setsite(t, s) ((t)->site = (s))
+
+#define hetH_clearsite(t) ((t)->site = NULL)
+
+/* called by 'hetH_resize' with the new sizes of 't' */
+#define hetH_recordsite(t, nasize, nhsize) \
+    { if ((t)->site != NULL) { \
+        (t)->site->asize = ((nasize) < HET_MAXSITEHINT) ? (nasize) \
+                                                       : HET_MAXSITEHINT; \
+        (t)->site->hsize = ((nhsize) < HET_MAXSITEHINT) ? (nhsize) \
+                                                       : HET_MAXSITEHINT; } }
+
+#else
+
+#define hetH_sitesizes(s, nasize, nhsize) ((void)0)
+#define hetH_setsite(t, s) ((void)0)
+#define hetH_clearsite(t) ((void)0)
+#define hetH_recordsite(t, nasize, nhsize) ((void)0)
+
+#endif
+
+/* }====================================================== */
+
+/*
+** {======================================================
+** Typed array parts
+** =======================================================
+*/
+
+/*
+** With HET_USE_TYPEDARRAYS, the array part of a table may be typed: a
+** C array of 'het_Integer' (ATYPE_INT) or of 'het_Number' (ATYPE_FLT)
+** whose first 'tlen' slots hold t[1] to t[tlen] and whose other slots
+** are empty. Resizing may unbox an array of values that is such a
+** sequence ('hetH_typeofarray' and 'hetH_unboxarray'). Writes keep the
+** array typed while they store numbers of its type at or before its
+** end, or remove its last element; any other write fails, and the
+** caller must box the array ('hetH_boxarray') and retry.
+**
+** As typed slots are not values, array access goes through
+** 'hetH_arrayget' and 'hetH_arrayset' (which copy values) instead of
+** pointers to the array; typed arrays have nothing to traverse nor any
+** barrier to run.
+*/
+
+#define ATYPE_BOXED 0 /* array of 'TValue' */
+#define ATYPE_INT 1 /* array of 'het_Integer' */
+#define ATYPE_FLT 2 /* array of 'het_Number' */
+
+#if defined(HET_USE_TYPEDARRAYS)
+
+#define arraytype(t) ((t)->atype)
+#define iarray(t) check_exp(arraytype(t) == ATYPE_INT, \
+                            cast(het_Integer *, (t)->array))
+#define farray(t) check_exp(arraytype(t) == ATYPE_FLT, \
+                            cast(het_Number *, (t)->array))
+
+/* get 'i'-th slot (0-based, within the array part) into 'res' */
+h_sinline int hetH_arrayget(const Table *t, unsigned int i, TValue *res) {
+    switch (arraytype(t)) {
+        case ATYPE_INT:
+            if (i >= t->tlen)
+                return 0;
+            setivalue(res, iarray(t)[i]);
+            return 1;
+        case ATYPE_FLT:
+            if (i >= t->tlen)
+                return 0;
+            setfltvalue(res, farray(t)[i]);
+            return 1;
+        default:
+            if (isempty(&t->array[i]))
+                return 0;
+            setobj(NULL, res, &t->array[i]);
+            return 1;
+    }
+}
+
+/*
+** Store 'v' in 'i'-th slot (0-based, within the array part). Returns
+** false, changing nothing, if a typed array cannot take it.
+*/
+h_sinline int hetH_arrayset(Table *t, unsigned int i, const TValue *v) {
+    switch (arraytype(t)) {
+        case ATYPE_INT:
+            if (ttisinteger(v) && i <= t->tlen) {
+                iarray(t)[i] = ivalue(v);
+                break;
+            }
+            goto other;
+        case ATYPE_FLT:
+            if (ttisfloat(v) && i <= t->tlen) {
+                farray(t)[i] = fltvalue(v);
+                break;
+            }
+        other:
+            if (!ttisnil(v))
+                return 0;
+            else if (i + 1 == t->tlen) /* remove last element? */
+                t->tlen--;
+            else if (i < t->tlen) /* would make a hole */
+                return 0;
+            return 1; /* (slots after 'tlen' are already empty) */
+        default:
+            setobj2t(NULL, &t->array[i], v);
+            return 1;
+    }
+    if (i == t->tlen) /* appended? */
+        t->tlen++;
+    return 1;
+}
+
+HETI_FUNC int hetH_typeofarray(const TValue *array, unsigned int size,
+                               unsigned int *tlen);
+HETI_FUNC void hetH_unboxarray(Table *t, void *newarray, int atype,
+                               unsigned int tlen);
+HETI_FUNC void hetH_boxarray(Table *t, TValue *newarray, unsigned int size);
+
+#else
+
+#define arraytype(t) ((void)(t), ATYPE_BOXED)
+
+#endif
+
+/* }====================================================== */
+
+HETI_FUNC const TValue *hetH_getint(Table *t, het_Integer key);
+HETI_FUNC const TValue *hetH_getshortstr(Table *t, TString *key);
+HETI_FUNC const TValue *hetH_getstr(Table *t, TString *key);
+HETI_FUNC const TValue *hetH_get(Table *t, const TValue *key);
+HETI_FUNC Table *hetH_new(het_State *L);
+HETI_FUNC void hetH_resize(het_State *L, Table *t, unsigned int nasize,
+                           unsigned int nhsize);
+HETI_FUNC void hetH_free(het_State *L, Table *t);
+HETI_FUNC het_Unsigned hetH_getn(Table *t);
+
+#endif
@@ -0,0 +1,48 @@
+/*
+** Pool of recycled threads
+*/
+#ifndef het_threadpool_h
+#define het_threadpool_h
+
+#include "het.h"
+#include "het_limits.h"
+
+/*
+** The global state keeps one 'ThreadPool'. A thread can only be reused
+** once nothing refers to it, so threads enter the pool when the
+** collector frees them: instead of freeing a thread, the sweep resets
+** it, trims its stack to 'stacksize' slots, keeps its CallInfo list and
+** offers it with 'hetE_poolput'. Resetting does only what freeing a
+** thread does: it closes open upvalues, and pending to-be-closed
+** variables stay unclosed, as calling their '__close' metamethods
+** would run Het code inside the sweep. The pool
+** holds threads outside the object lists, so collectors never see
+** them. 'het_newthread' first tries 'hetE_poolget', and links a pooled
+** thread back as a new white object.
+**
+** 'het_setthreadpool' frees the threads over the new capacity (taken
+** with 'hetE_pooldrain') and then gives the pool a new array of slots
+** ('hetE_resizepool' returns the old one). Threads kept by the pool are
+** freed in the same way when the state closes.
+*/
+typedef struct ThreadPool {
+    het_State **slots; /* pooled threads, 'slots[0..n-1]' */
+    int n;
+    int max; /* capacity of 'slots' */
+    int stacksize; /* stack size of pooled threads, in slots */
+    het_ThreadPoolStats st;
+} ThreadPool;
+
+#if !defined(HETI_THREADPOOLSTACK)
+#define HETI_THREADPOOLSTACK (2 * HET_MINSTACK)
+#endif
+
+HETI_FUNC void hetE_initpool(ThreadPool *tp);
+HETI_FUNC het_State **hetE_resizepool(ThreadPool *tp, het_State **slots,
+                                      int max);
+HETI_FUNC het_State *hetE_pooldrain(ThreadPool *tp, int max);
+HETI_FUNC het_State *hetE_poolget(ThreadPool *tp);
+HETI_FUNC int hetE_poolput(ThreadPool *tp, het_State *L1);
+HETI_FUNC void hetE_poolstats(const ThreadPool *tp, het_ThreadPoolStats *st);
+
+#endif
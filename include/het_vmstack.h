@@ -0,0 +1,58 @@
+/*
+** Het stacks in reserved address space
+*/
+#ifndef het_vmstack_h
+#define het_vmstack_h
+
+#include "het_limits.h"
+
+/*
+** With HET_USE_VMSTACK, a Het stack that grows beyond HETI_VMSTACKMIN
+** bytes moves (once) to a range of address space reserved for its
+** largest possible size (HETI_MAXSTACK slots plus the error space),
+** where memory is committed only as it grows. From then on the stack
+** never moves: growing it does not need to turn stack pointers and open
+** upvalues into offsets and back, nor to copy it. Shrinking gives whole
+** pages back to the system but keeps the range.
+**
+** Small stacks (most coroutines) stay on the state allocator, as each
+** reservation costs some megabytes of address space and one or two
+** kernel memory mappings, which are limited (on Linux,
+** vm.max_map_count, 65530 by default). At most HETI_MAXVMSTACKS
+** reservations exist at once in the process; after that, and when the
+** system refuses a reservation, stacks just stay on the allocator, so
+** the stack code keeps its reallocation path for them.
+**
+** 'hetD_vmwants' tells the stack code whether a stack growing to 'size'
+** bytes should try to move to a reservation. Reserving suits 64-bit
+** systems; reserved stacks are mapped, not allocated, so their memory
+** is not counted as GC debt.
+*/
+
+#if !defined(HETI_VMSTACKMIN)
+#define HETI_VMSTACKMIN (64 * 1024)
+#endif
+
+#if !defined(HETI_MAXVMSTACKS)
+#define HETI_MAXVMSTACKS 8192
+#endif
+
+typedef struct VMStack {
+    char *base; /* start of the reserved range (NULL if none) */
+    size_t reserved; /* size of the reserved range */
+    size_t committed; /* bytes usable from 'base' */
+} VMStack;
+
+#if defined(HET_USE_VMSTACK)
+
+HETI_FUNC int hetD_vmreserve(VMStack *vs, size_t size);
+HETI_FUNC int hetD_vmcommit(VMStack *vs, size_t size);
+HETI_FUNC void hetD_vmdecommit(VMStack *vs, size_t size);
+HETI_FUNC void hetD_vmrelease(VMStack *vs);
+
+#define hetD_vmwants(vs, size) \
+    ((vs)->base == NULL && (size) >= HETI_VMSTACKMIN)
+
+#endif
+
+#endif
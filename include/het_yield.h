@@ -0,0 +1,73 @@
+/*
+** Yielding without unwinding
+*/
+#ifndef het_yield_h
+#define het_yield_h
+
+#include "het_limits.h"
+
+/*
+** A yield usually unwinds the C stack back to 'het_resume' by throwing
+** HET_YIELD, as it must when C functions sit between the two. But when
+** the function calling 'het_yieldk' was called directly by a Het
+** function and the coroutine has no other C levels (the case of
+** 'coroutine.yield' called from Het code, as generators do) there is
+** nothing to unwind: every Het frame lives in the same run of the
+** interpreter, started by 'het_resume'.
+**
+** In that case 'het_yieldk' stores the continuation and the number of
+** results as usual, sets the status to HET_YIELD and returns
+** HETI_YIELDED instead of throwing. 'het_yieldk' may only be called as
+** the return expression of a C function, so HETI_YIELDED reaches the
+** caller of the C function, which leaves its CallInfo in place (as a
+** throw would) and makes the interpreter return.
+**
+** The protocol needs these changes in the state and call modules:
+**
+** - 'het_State' gets a field 'h_uint32 yieldbase'. Before entering the
+**   interpreter (to start the coroutine or to continue it after a
+**   yield), 'het_resume' sets it with 'hetD_setyieldbase', the number
+**   of C calls of the thread at that point. A direct call from Het code
+**   adds no C levels, so 'hetD_canfastyield' finds the count unchanged
+**   exactly when no other C function is in between.
+**
+** - After a fast yield the protected run ends normally, so
+**   'hetD_rawrunprotected' returns HET_OK with the thread suspended.
+**   'het_resume' must then take its status from 'L->status', through
+**   'hetD_resumestatus', before testing it; from there on it handles
+**   the yield as after a throw (the number of results is in
+**   'ci->u2.nyield').
+**
+** - Resuming a thread suspended this way takes the usual path for a
+**   yield from a C function: 'het_resume' finds a C frame on top, calls
+**   its continuation (if any), finishes the frame with the values passed
+**   to the resume as its results, and continues the Het frames below.
+*/
+
+/*
+** Value returned by a C function that yielded without unwinding. It
+** also reaches 'hetD_pretailcall' (for 'return coroutine.yield(x)'),
+** where -1 already means "a Het function, go run it", so it must be
+** some other negative value.
+*/
+#define HETI_YIELDED (-2)
+
+#define hetD_setyieldbase(L) ((L)->yieldbase = getCcalls(L))
+
+#define hetD_canfastyield(L, ci) \
+    (!isHet(ci) && isHet((ci)->previous) && getCcalls(L) == (L)->yieldbase)
+
+/*
+** For the callers of a C function ('precallC' and, through it,
+** 'hetD_pretailcall'): after a fast yield, the result count 'n' is
+** HETI_YIELDED and the frame stays in the stack.
+*/
+#define hetD_yielded(L, n) \
+    (h_unlikely((n) == HETI_YIELDED) && \
+     check_exp((L)->status == HET_YIELD, 1))
+
+/* status of a resume whose protected run returned 'st' */
+#define hetD_resumestatus(L, st) \
+    (((st) == HET_OK && (L)->status == HET_YIELD) ? HET_YIELD : (st))
+
+#endif
@@ -0,0 +1,325 @@
+#define het_alloc_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "het.h"
+#include "het_alloc.h"
+
+/*
+** {======================================================
+** Size-class pool
+** =======================================================
+*/
+
+/* a free block, linked in the free list of its class */
+typedef struct FreeBlock {
+    struct FreeBlock *next;
+} FreeBlock;
+
+/* slabs are kept in a list, to be released by 'het_closepool' */
+typedef struct Slab {
+    struct Slab *next;
+    union {HETI_MAXALIGN;} mem; /* start of the blocks */
+} Slab;
+
+#define SLABHEADER offsetof(Slab, mem)
+
+struct het_Pool {
+    FreeBlock *freelist[HET_POOLNCLASSES];
+    char *bump; /* unused part of the current slab */
+    char *bumpend;
+    Slab *slabs;
+    het_PoolStats st;
+};
+
+/* size class of a (non-zero) size; large blocks are not pooled */
+#define sizeclass(sz) (((sz) - 1) / HET_POOLGRAIN)
+#define classsize(c) (((c) + 1) * HET_POOLGRAIN)
+#define ispooled(sz) ((sz) <= HET_POOLMAXSIZE)
+
+het_Pool *het_newpool(void) {
+    het_Pool *p = (het_Pool *)malloc(sizeof(het_Pool));
+    if (p != NULL)
+        memset(p, 0, sizeof(het_Pool));
+    return p;
+}
+
+void het_closepool(het_Pool *p) {
+    Slab *s = p->slabs;
+    while (s != NULL) {
+        Slab *next = s->next;
+        free(s);
+        s = next;
+    }
+    free(p);
+}
+
+/*
+** Get a block of class 'c': from its free list if possible, otherwise
+** from the current slab, allocating a new slab when it is exhausted.
+** (What is left of an exhausted slab is smaller than the block and is
+** wasted.)
+*/
+static void *poolget(het_Pool *p, int c) {
+    size_t sz = classsize(c);
+    FreeBlock *b = p->freelist[c];
+    if (b != NULL)
+        p->freelist[c] = b->next;
+    else {
+        if ((size_t)(p->bumpend - p->bump) < sz) {
+            Slab *s = (Slab *)malloc(SLABHEADER + HET_POOLSLAB);
+            if (s == NULL)
+                return NULL;
+            s->next = p->slabs;
+            p->slabs = s;
+            p->st.slabs++;
+            p->bump = (char *)s + SLABHEADER;
+            p->bumpend = p->bump + HET_POOLSLAB;
+        }
+        b = (FreeBlock *)p->bump;
+        p->bump += sz;
+    }
+    p->st.live[c] += sz;
+    p->st.nblocks[c]++;
+    return b;
+}
+
+static void poolput(het_Pool *p, void *block, int c) {
+    FreeBlock *b = (FreeBlock *)block;
+    b->next = p->freelist[c];
+    p->freelist[c] = b;
+    p->st.live[c] -= classsize(c);
+    p->st.nblocks[c]--;
+}
+
+static void poolfree(het_Pool *p, void *block, size_t osize) {
+    if (ispooled(osize))
+        poolput(p, block, sizeclass(osize));
+    else {
+        free(block);
+        p->st.largelive -= osize;
+    }
+}
+
+/*
+** Keep block 'ptr' when a shrink to 'nsize' fails (there is no memory
+** to move it to a smaller class, or 'realloc' failed). The block is big
+** enough, and it will be freed with size 'nsize', so it is counted as a
+** block of that size from now on. (A large block kept for a pooled size
+** is never given back to the system, not even by 'het_closepool', but
+** that only happens when memory is already exhausted.)
+*/
+static void *keepblock(het_Pool *p, void *ptr, size_t osize, size_t nsize) {
+    if (ispooled(osize)) {
+        p->st.live[sizeclass(osize)] -= classsize(sizeclass(osize));
+        p->st.nblocks[sizeclass(osize)]--;
+    } else
+        p->st.largelive -= osize;
+    if (ispooled(nsize)) {
+        p->st.live[sizeclass(nsize)] += classsize(sizeclass(nsize));
+        p->st.nblocks[sizeclass(nsize)]++;
+    } else
+        p->st.largelive += nsize;
+    return ptr;
+}
+
+/*
+** A 'het_Alloc' over a pool ('ud'). When 'ptr' is NULL, 'osize' encodes
+** the kind of object being created and is ignored.
+*/
+void *het_poolalloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+    het_Pool *p = (het_Pool *)ud;
+    void *nptr;
+    if (ptr == NULL)
+        osize = 0;
+    if (nsize == 0) {
+        if (ptr != NULL)
+            poolfree(p, ptr, osize);
+        return NULL;
+    }
+    if (ptr != NULL && ispooled(osize) && ispooled(nsize) &&
+        sizeclass(osize) == sizeclass(nsize))
+        return ptr; /* block already has the right class */
+    if (ptr != NULL && !ispooled(osize) && !ispooled(nsize)) {
+        nptr = realloc(ptr, nsize);
+        if (nptr == NULL && nsize <= osize)
+            return keepblock(p, ptr, osize, nsize); /* shrinking cannot fail */
+        if (nptr != NULL) /* only a successful realloc changes the block */
+            p->st.largelive = p->st.largelive - osize + nsize;
+        return nptr;
+    }
+    if (ispooled(nsize))
+        nptr = poolget(p, sizeclass(nsize));
+    else {
+        nptr = malloc(nsize);
+        if (nptr != NULL)
+            p->st.largelive += nsize;
+    }
+    if (nptr == NULL && nsize <= osize)
+        return keepblock(p, ptr, osize, nsize); /* shrinking cannot fail */
+    if (nptr != NULL && ptr != NULL) {
+        memcpy(nptr, ptr, osize < nsize ? osize : nsize);
+        poolfree(p, ptr, osize);
+    }
+    return nptr;
+}
+
+void het_poolstats(het_Pool *p, het_PoolStats *st) {
+    *st = p->st;
+}
+
+/* }====================================================== */
+
+
+/*
+** {======================================================
+** Arena
+** =======================================================
+*/
+
+typedef struct Chunk {
+    struct Chunk *next;
+    size_t size; /* usable size */
+    union {HETI_MAXALIGN;} mem; /* start of the blocks */
+} Chunk;
+
+#define CHUNKHEADER offsetof(Chunk, mem)
+
+struct het_Arena {
+    Chunk *chunks; /* current chunk first (once there is one) */
+    char *bump; /* unused part of the current chunk */
+    char *bumpend;
+    char *last; /* most recent block, which can be resized in place */
+    size_t used; /* bytes handed out (including dead blocks) */
+};
+
+/* keep every block aligned as 'HETI_MAXALIGN' */
+typedef union { HETI_MAXALIGN; } MaxAlign;
+#define arenaround(sz) \
+    (((sz) + sizeof(MaxAlign) - 1) / sizeof(MaxAlign) * sizeof(MaxAlign))
+
+het_Arena *het_newarena(void) {
+    het_Arena *a = (het_Arena *)malloc(sizeof(het_Arena));
+    if (a != NULL)
+        memset(a, 0, sizeof(het_Arena));
+    return a;
+}
+
+static void freechunks(Chunk *c) {
+    while (c != NULL) {
+        Chunk *next = c->next;
+        free(c);
+        c = next;
+    }
+}
+
+void het_closearena(het_Arena *a) {
+    freechunks(a->chunks);
+    free(a);
+}
+
+/*
+** Forget all blocks, keeping only the current chunk (the first
+** standard-size one) for the next state.
+*/
+void het_resetarena(het_Arena *a) {
+    Chunk *keep = NULL;
+    Chunk *c = a->chunks;
+    while (c != NULL) {
+        Chunk *next = c->next;
+        if (keep == NULL && c->size == HET_ARENACHUNK) {
+            keep = c;
+            keep->next = NULL;
+        }
+        else
+            free(c);
+        c = next;
+    }
+    a->chunks = keep;
+    a->bump = (keep != NULL) ? (char *)keep + CHUNKHEADER : NULL;
+    a->bumpend = (keep != NULL) ? a->bump + keep->size : NULL;
+    a->last = NULL;
+    a->used = 0;
+}
+
+/*
+** A new standard chunk becomes the current one, at the head of the
+** list; an oversized chunk goes after the head, so that it does not
+** hide the current chunk.
+*/
+static Chunk *newchunk(het_Arena *a, size_t csize) {
+    Chunk *c = (Chunk *)malloc(CHUNKHEADER + csize);
+    if (c != NULL) {
+        Chunk **prev = (csize > HET_ARENACHUNK && a->chunks != NULL)
+                           ? &a->chunks->next : &a->chunks;
+        c->size = csize;
+        c->next = *prev;
+        *prev = c;
+    }
+    return c;
+}
+
+/*
+** A block bigger than a chunk gets a chunk of its own, which does not
+** replace the current one: the rest of the current chunk is still used
+** by the next blocks (and its last block can still grow in place).
+*/
+static void *arenaget(het_Arena *a, size_t sz) {
+    char *b;
+    if (sz > HET_ARENACHUNK) {
+        Chunk *c = newchunk(a, sz);
+        if (c == NULL)
+            return NULL;
+        a->used += sz;
+        return (char *)c + CHUNKHEADER;
+    }
+    if ((size_t)(a->bumpend - a->bump) < sz) {
+        Chunk *c = newchunk(a, HET_ARENACHUNK);
+        if (c == NULL)
+            return NULL;
+        a->bump = (char *)c + CHUNKHEADER;
+        a->bumpend = a->bump + HET_ARENACHUNK;
+    }
+    b = a->bump;
+    a->bump += sz;
+    a->last = b;
+    a->used += sz;
+    return b;
+}
+
+void *het_arenaalloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+    het_Arena *a = (het_Arena *)ud;
+    size_t orsize, nrsize;
+    void *nptr;
+    if (ptr == NULL)
+        osize = 0;
+    orsize = arenaround(osize);
+    nrsize = arenaround(nsize);
+    if ((char *)ptr == a->last && ptr != NULL) { /* most recent block? */
+        if (nsize == 0 || (size_t)(a->bumpend - (char *)ptr) >= nrsize) {
+            a->bump = (char *)ptr + nrsize; /* resize (or free) in place */
+            a->used = a->used - orsize + nrsize;
+            if (nsize == 0)
+                a->last = NULL;
+            return (nsize == 0) ? NULL : ptr;
+        }
+    }
+    if (nsize == 0)
+        return NULL; /* memory is only reclaimed with the arena */
+    if (ptr != NULL && nrsize <= orsize)
+        return ptr; /* shrinking: keep the block */
+    nptr = arenaget(a, nrsize);
+    if (nptr != NULL && ptr != NULL)
+        memcpy(nptr, ptr, osize);
+    return nptr;
+}
+
+size_t het_arenaused(het_Arena *a) {
+    return a->used;
+}
+
+/* }====================================================== */
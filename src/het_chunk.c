@@ -0,0 +1,268 @@
+#define het_chunk_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "het.h"
+#include "het_chunk.h"
+
+/* alignment of type 't' */
+#define alignof_(t) offsetof(struct { char c; t x; }, x)
+
+static const size_t elemsize[HETC_NSECTIONS] = {
+    sizeof(ChunkProto), sizeof(Instruction), sizeof(ChunkConst),
+    sizeof(ChunkUpval), sizeof(h_uint32), sizeof(hs_byte),
+    sizeof(AbsLineInfo), sizeof(ChunkLocVar), sizeof(ChunkString),
+    sizeof(char)
+};
+
+static const size_t elemalign[HETC_NSECTIONS] = {
+    alignof_(ChunkProto), alignof_(Instruction), alignof_(ChunkConst),
+    alignof_(ChunkUpval), alignof_(h_uint32), alignof_(hs_byte),
+    alignof_(AbsLineInfo), alignof_(ChunkLocVar), alignof_(ChunkString),
+    alignof_(char)
+};
+
+size_t hetU_elemsize(int kind) {
+    het_assert(0 <= kind && kind < HETC_NSECTIONS);
+    return elemsize[kind];
+}
+
+size_t hetU_elemalign(int kind) {
+    het_assert(0 <= kind && kind < HETC_NSECTIONS);
+    return elemalign[kind];
+}
+
+/* global sections belong to the chunk, not to a prototype */
+#define isglobal(k) ((k) == HETC_SSTRINGS || (k) == HETC_SCHARS)
+
+/*
+** Find section 'kind' of prototype 'proto' in a chunk already accepted
+** by 'hetU_checkchunk'. Returns NULL (and zero elements) when the
+** section is absent, which is the same as an empty one.
+*/
+const void *hetU_section(const char *buff, h_uint32 proto, int kind,
+                         h_uint32 *count) {
+    const ChunkHeader *h = chunkheader(buff);
+    const ChunkSection *s = chunksections(buff);
+    size_t lo = 0, hi = h->nsections; /* binary search in [lo, hi) */
+    while (lo < hi) {
+        size_t m = (lo + hi) / 2;
+        if (s[m].proto < proto ||
+            (s[m].proto == proto && s[m].kind < cast_uint(kind)))
+            lo = m + 1;
+        else
+            hi = m;
+    }
+    if (lo < h->nsections && s[lo].proto == proto &&
+        s[lo].kind == cast_uint(kind)) {
+        *count = s[lo].count;
+        return buff + s[lo].offset;
+    }
+    *count = 0;
+    return NULL;
+}
+
+/*
+** {======================================================
+** Validation
+** =======================================================
+*/
+
+/*
+** 'hetU_checkchunk' checks everything a loader relies on, so that
+** adopting the sections needs no further checks: the header matches
+** this build, every section lies inside the chunk with the alignment
+** of its elements, each prototype has its header, nested prototypes
+** come after their parents (so there are no cycles), and every string
+** index is valid.
+** Instructions themselves are not verified, as in the byte format.
+** Returns NULL if the chunk is valid, or an error message.
+*/
+
+typedef struct CheckState {
+    const char *buff;
+    const ChunkHeader *h;
+    h_uint32 nstrings;
+} CheckState;
+
+static int checkstring(CheckState *S, h_uint32 str, int optional) {
+    return (optional && str == HETC_NOSTRING) || str < S->nstrings;
+}
+
+static const char *checkheader(const ChunkHeader *h, size_t size) {
+    if (size < sizeof(ChunkHeader) ||
+        memcmp(h->signature, HET_SIGNATURE, sizeof(h->signature)) != 0)
+        return "not a precompiled chunk";
+    if (h->version != HETC_VERSION)
+        return "version mismatch";
+    if (h->format != HETC_FORMAT)
+        return "format mismatch";
+    if (h->sizeinstruction != sizeof(Instruction) ||
+        h->sizeinteger != sizeof(het_Integer) ||
+        h->sizenumber != sizeof(het_Number) ||
+        h->headersize != sizeof(ChunkHeader) ||
+        h->sectionsize != sizeof(ChunkSection))
+        return "size mismatch";
+    if (h->checkint != HETC_INT)
+        return "integer format mismatch";
+    if (h->checknum != HETC_NUM)
+        return "float format mismatch";
+    if (h->size > size || h->size < sizeof(ChunkHeader))
+        return "truncated chunk";
+    if (h->nprotos == 0)
+        return "no main function";
+    if (h->nsections >
+        (h->size - sizeof(ChunkHeader)) / sizeof(ChunkSection))
+        return "truncated section table";
+    return NULL;
+}
+
+static const char *checksections(CheckState *S) {
+    const ChunkHeader *h = S->h;
+    const ChunkSection *s = chunksections(S->buff);
+    size_t datastart = sizeof(ChunkHeader) +
+                       cast_sizet(h->nsections) * sizeof(ChunkSection);
+    h_uint32 nprotos = 0;
+    h_uint32 i;
+    for (i = 0; i < h->nsections; i++) {
+        h_uint32 k = s[i].kind;
+        if (k >= HETC_NSECTIONS || s[i].proto >= h->nprotos)
+            return "bad section";
+        if (i > 0 && (s[i].proto < s[i - 1].proto ||
+                      (s[i].proto == s[i - 1].proto && k <= s[i - 1].kind)))
+            return "unordered sections";
+        if (isglobal(k) && s[i].proto != 0)
+            return "bad section";
+        if (s[i].offset < datastart || s[i].offset > h->size ||
+            s[i].offset % elemalign[k] != 0)
+            return "misplaced section";
+        if (s[i].count > (h->size - s[i].offset) / elemsize[k])
+            return "truncated section";
+        if (k == HETC_SPROTO) {
+            if (s[i].proto != nprotos || s[i].count != 1)
+                return "bad prototype header";
+            nprotos++;
+        }
+    }
+    if (nprotos != h->nprotos)
+        return "missing prototype header";
+    return NULL;
+}
+
+static const char *checkstrings(CheckState *S) {
+    h_uint32 nchars, i;
+    const ChunkString *str = cast(const ChunkString *,
+        hetU_section(S->buff, 0, HETC_SSTRINGS, &S->nstrings));
+    const char *chars = cast_charp(
+        hetU_section(S->buff, 0, HETC_SCHARS, &nchars));
+    for (i = 0; i < S->nstrings; i++) {
+        if (str[i].offset >= nchars || str[i].len >= nchars - str[i].offset ||
+            chars[str[i].offset + str[i].len] != '\0')
+            return "bad string";
+    }
+    return NULL;
+}
+
+static const char *checkproto(CheckState *S, h_uint32 p) {
+    h_uint32 n, i;
+    const ChunkProto *f = cast(const ChunkProto *,
+        hetU_section(S->buff, p, HETC_SPROTO, &n));
+    const ChunkConst *k = cast(const ChunkConst *,
+        hetU_section(S->buff, p, HETC_SCONST, &n));
+    if (!checkstring(S, f->source, 1))
+        return "bad string index";
+    for (i = 0; i < n; i++) {
+        switch (k[i].tt) {
+            case HET_VNIL: case HET_VFALSE: case HET_VTRUE:
+            case HET_VNUMINT: case HET_VNUMFLT:
+                break;
+            case HET_VSHRSTR: case HET_VLNGSTR:
+                if (!checkstring(S, k[i].str, 0))
+                    return "bad string index";
+                break;
+            default:
+                return "bad constant";
+        }
+    }
+    {
+        const ChunkUpval *uv = cast(const ChunkUpval *,
+            hetU_section(S->buff, p, HETC_SUPVAL, &n));
+        for (i = 0; i < n; i++)
+            if (!checkstring(S, uv[i].name, 1))
+                return "bad string index";
+    }
+    {
+        const ChunkLocVar *lv = cast(const ChunkLocVar *,
+            hetU_section(S->buff, p, HETC_SLOCVARS, &n));
+        for (i = 0; i < n; i++)
+            if (!checkstring(S, lv[i].varname, 1))
+                return "bad string index";
+    }
+    {
+        /* preorder numbering: children come after their parent */
+        const h_uint32 *child = cast(const h_uint32 *,
+            hetU_section(S->buff, p, HETC_SPROTOS, &n));
+        for (i = 0; i < n; i++)
+            if (child[i] <= p || child[i] >= S->h->nprotos ||
+                (i > 0 && child[i] <= child[i - 1]))
+                return "bad nested prototype";
+    }
+    return NULL;
+}
+
+/*
+** Each prototype but the main one must be the child of exactly one
+** other; as children come after their parents, they then form a tree
+** rooted at the main function.
+*/
+static const char *checktree(CheckState *S) {
+    h_uint32 nprotos = S->h->nprotos;
+    h_uint32 p, n, i;
+    const char *msg = NULL;
+    char *seen = (char *)calloc(nprotos, 1);
+    if (seen == NULL)
+        return "not enough memory";
+    for (p = 0; p < nprotos && msg == NULL; p++) {
+        const h_uint32 *child = cast(const h_uint32 *,
+            hetU_section(S->buff, p, HETC_SPROTOS, &n));
+        for (i = 0; i < n; i++) {
+            if (seen[child[i]]) { /* shared prototype? */
+                msg = "bad nested prototype";
+                break;
+            }
+            seen[child[i]] = 1;
+        }
+    }
+    for (p = 1; p < nprotos && msg == NULL; p++)
+        if (!seen[p]) /* unreachable prototype? */
+            msg = "bad nested prototype";
+    free(seen);
+    return msg;
+}
+
+const char *hetU_checkchunk(const char *buff, size_t size) {
+    CheckState S;
+    const char *msg;
+    h_uint32 p;
+    if ((cast(H_P2I, buff) & (HETC_ALIGN - 1)) != 0)
+        return "misaligned chunk";
+    S.buff = buff;
+    S.h = chunkheader(buff);
+    S.nstrings = 0;
+    if ((msg = checkheader(S.h, size)) != NULL ||
+        (msg = checksections(&S)) != NULL ||
+        (msg = checkstrings(&S)) != NULL)
+        return msg;
+    for (p = 0; p < S.h->nprotos; p++) {
+        if ((msg = checkproto(&S, p)) != NULL)
+            return msg;
+    }
+    return checktree(&S);
+}
+
+/* }====================================================== */
@@ -0,0 +1,50 @@
+#define het_debug_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include "het_debug.h"
+
+/*
+** Get a "base line" to find the line corresponding to an instruction.
+** Base lines are regularly placed at 'abslineinfo', sorted by pc; find
+** the last one not after 'pc' (binary search) and return its line and
+** (in 'basepc') its pc. When there is none, the base is the line where
+** the function was defined, before its first instruction.
+*/
+static int getbaseline(const Proto *f, int pc, int *basepc) {
+    if (f->sizeabslineinfo == 0 || pc < f->abslineinfo[0].pc) {
+        *basepc = -1; /* start from the beginning */
+        return f->linedefined;
+    } else {
+        int lo = 0, hi = f->sizeabslineinfo; /* abslineinfo[lo].pc <= pc */
+        while (hi - lo > 1) {
+            int m = lo + (hi - lo) / 2;
+            if (f->abslineinfo[m].pc <= pc)
+                lo = m;
+            else
+                hi = m;
+        }
+        *basepc = f->abslineinfo[lo].pc;
+        return f->abslineinfo[lo].line;
+    }
+}
+
+/*
+** Get the line corresponding to instruction 'pc' in function 'f';
+** first gets a base line and from there does the increments until the
+** desired instruction. Returns -1 for stripped functions.
+*/
+int hetG_getfuncline(const Proto *f, int pc) {
+    if (f->lineinfo == NULL) /* no debug information? */
+        return -1;
+    else {
+        int basepc;
+        int baseline = getbaseline(f, pc, &basepc);
+        while (basepc++ < pc) { /* walk until given instruction */
+            het_assert(f->lineinfo[basepc] != ABSLINEINFO);
+            baseline += f->lineinfo[basepc]; /* correct line */
+        }
+        return baseline;
+    }
+}
@@ -0,0 +1,95 @@
+#define het_gcstats_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include <string.h>
+#include <time.h>
+
+#include "het.h"
+#include "het_gcstats.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+/*
+** Monotonic clock in microseconds. Define 'heti_clock' to use another
+** time source.
+*/
+unsigned long hetC_clock(void) {
+#if defined(heti_clock)
+    return heti_clock();
+#elif defined(_WIN32)
+    static LARGE_INTEGER freq; /* constant after the first call */
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    /* 'now * 1000000' would overflow after some days of uptime */
+    return (unsigned long)(now.QuadPart / freq.QuadPart * 1000000 +
+                           now.QuadPart % freq.QuadPart * 1000000 /
+                           freq.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000000ul +
+           (unsigned long)(ts.tv_nsec / 1000);
+#else /* ISO C: processor time, coarse but portable */
+    return (unsigned long)((double)clock() * 1e6 / CLOCKS_PER_SEC);
+#endif
+}
+
+/*
+** Histogram bucket for a duration: the number of bits of 'us', capped
+** at the last bucket.
+*/
+int hetC_histbucket(unsigned long us) {
+    int b = 0;
+    while (us != 0 && b < HET_GCHISTSIZE - 1) {
+        us >>= 1;
+        b++;
+    }
+    return b;
+}
+
+void hetC_resetstats(GCStats *gs) {
+    memset(&gs->st, 0, sizeof(gs->st));
+    gs->cyclepause = 0;
+}
+
+void hetC_recordstep(GCStats *gs, unsigned long us, size_t traversed,
+                     size_t freed) {
+    het_GCStats *st = &gs->st;
+    st->nsteps++;
+    st->steptime += us;
+    if (us > st->maxstep)
+        st->maxstep = us;
+    st->traversed += traversed;
+    st->freed += freed;
+    st->stephist[hetC_histbucket(us)]++;
+    gs->cyclepause += us;
+}
+
+void hetC_recordcycle(GCStats *gs) {
+    het_GCStats *st = &gs->st;
+    unsigned long us = gs->cyclepause;
+    st->ncycles++;
+    if (us > st->maxcycle)
+        st->maxcycle = us;
+    st->cyclehist[hetC_histbucket(us)]++;
+    gs->cyclepause = 0;
+}
+
+void hetC_budgetinit(GCBudget *b, unsigned long us) {
+    b->start = hetC_clock();
+    b->limit = us;
+    b->expired = (us == 0);
+}
+
+/* read the clock; false once the budget is spent */
+int hetC_budgetcheck(GCBudget *b) {
+    if (hetC_clock() - b->start >= b->limit)
+        b->expired = 1;
+    return !b->expired;
+}
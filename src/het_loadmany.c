@@ -0,0 +1,368 @@
+#define het_loadmany_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "het.h"
+#include "het_chunk.h"
+
+#if defined(HET_USE_POSIX)
+#include <pthread.h>
+#endif
+
+/*
+** 'het_loadmany' splits loading in two parts. A job runs the reader
+** (which usually means file I/O and decompression), checks the mode and
+** validates binary chunks, on any thread. With threads, it also
+** compiles text chunks: each thread parses them in a scratch state of
+** its own and dumps the result in the aligned format, which the job
+** keeps instead of the text. Creating the functions needs the state and
+** is done by the calling thread, in order, as soon as the job of each
+** chunk is done; for compiled chunks that is just loading the aligned
+** dump. The calling thread runs jobs itself while the next chunk to
+** create is not ready, so with no helpers (or no threads) everything
+** runs serially.
+*/
+
+#define MSGSIZE 120
+
+typedef struct LoadJob {
+    het_ChunkSource *src;
+    char *base; /* allocated block (NULL if none) */
+    const char *data; /* chunk contents, inside 'base' */
+    size_t size;
+    int status; /* HET_OK or error found by the job */
+    int compiled; /* true if 'data' is a dump of the text chunk */
+    int done; /* (protected by the lock) */
+    char *err; /* error message from a scratch state (or NULL) */
+    char msg[MSGSIZE];
+} LoadJob;
+
+typedef struct LoadMany {
+    LoadJob *jobs;
+    int n;
+    int next; /* first job not yet started */
+#if defined(HET_USE_POSIX)
+    pthread_mutex_t lock;
+    pthread_cond_t cond; /* signaled when a job is done */
+#endif
+} LoadMany;
+
+static int joberror(LoadJob *j, int status, const char *msg) {
+    j->status = status;
+    snprintf(j->msg, MSGSIZE, "%s", msg);
+    return 0;
+}
+
+/* give 'j' the 'n' bytes in 'buff' (with HETC_ALIGN bytes to spare) */
+static void setjobdata(LoadJob *j, char *buff, size_t n) {
+    j->base = buff;
+    j->size = n;
+    if (buff != NULL) { /* move contents to an aligned address */
+        size_t pad = (HETC_ALIGN - cast(H_P2I, buff) % HETC_ALIGN) % HETC_ALIGN;
+        if (pad != 0)
+            memmove(buff + pad, buff, n);
+        j->data = buff + pad;
+    } else
+        j->data = "";
+}
+
+/* read the whole chunk into an aligned block */
+static int readchunk(LoadJob *j) {
+    char *buff = NULL;
+    size_t n = 0, size = 0;
+    size_t sz;
+    const char *p;
+    while ((p = j->src->reader(NULL, j->src->data, &sz)) != NULL && sz > 0) {
+        if (sz > size - n) {
+            char *nb;
+            size_t newsize = (size == 0) ? BUFSIZ : size;
+            while (sz > newsize - n)
+                newsize *= 2;
+            nb = (char *)realloc(buff, newsize + HETC_ALIGN);
+            if (nb == NULL) {
+                free(buff);
+                return joberror(j, HET_ERRMEM, "not enough memory");
+            }
+            buff = nb;
+            size = newsize;
+        }
+        memcpy(buff + n, p, sz);
+        n += sz;
+    }
+    setjobdata(j, buff, n);
+    return 1;
+}
+
+static int checkmode(LoadJob *j) {
+    const char *mode = j->src->mode;
+    const char *x = (j->size > 0 && j->data[0] == HET_SIGNATURE[0])
+                        ? "binary"
+                        : "text";
+    if (mode != NULL && strchr(mode, x[0]) == NULL) {
+        j->status = HET_ERRSYNTAX;
+        snprintf(j->msg, MSGSIZE, "attempt to load a %s chunk (mode is '%s')",
+                 x, mode);
+        return 0;
+    }
+    return 1;
+}
+
+/* aligned binary chunks are validated here, off the state's thread */
+static void checkbinary(LoadJob *j) {
+    const char *s = HET_SIGNATURE;
+    size_t ls = sizeof(HET_SIGNATURE) - 1;
+    if (j->size > ls + 1 && memcmp(j->data, s, ls) == 0 &&
+        cast_byte(j->data[ls + 1]) == HETC_FORMAT) {
+        const char *msg = hetU_checkchunk(j->data, j->size);
+        if (msg != NULL) {
+            j->status = HET_ERRSYNTAX;
+            snprintf(j->msg, MSGSIZE, "bad binary format (%s)", msg);
+        }
+    }
+}
+
+/* reader for the contents of a job */
+static const char *getjob(het_State *L, void *ud, size_t *sz) {
+    LoadJob *j = (LoadJob *)ud;
+    (void)L;
+    if (j->size == 0)
+        return NULL;
+    *sz = j->size;
+    j->size = 0;
+    return j->data;
+}
+
+typedef struct DumpBuff {
+    char *b;
+    size_t n;
+    size_t size;
+} DumpBuff;
+
+static int dumpjob(het_State *L, const void *p, size_t sz, void *ud) {
+    DumpBuff *db = (DumpBuff *)ud;
+    (void)L;
+    if (sz > db->size - db->n) {
+        char *nb;
+        size_t newsize = (db->size == 0) ? BUFSIZ : db->size;
+        while (sz > newsize - db->n)
+            newsize *= 2;
+        nb = (char *)realloc(db->b, newsize + HETC_ALIGN);
+        if (nb == NULL)
+            return 1;
+        db->b = nb;
+        db->size = newsize;
+    }
+    memcpy(db->b + db->n, p, sz);
+    db->n += sz;
+    return 0;
+}
+
+/*
+** Parse text chunk 'j' in scratch state 'S' and replace its contents by
+** an aligned dump of the result (with debug information, so the loaded
+** function is the same as if the text were loaded).
+*/
+static void compilejob(LoadJob *j, het_State *S) {
+    DumpBuff db;
+    int top = het_gettop(S);
+    j->status = het_load(S, getjob, j, j->src->chunkname, "t");
+    if (j->status != HET_OK) {
+        const char *msg = het_tostring(S, -1);
+        size_t l = (msg != NULL) ? strlen(msg) : 0;
+        if ((j->err = (char *)malloc(l + 1)) != NULL)
+            memcpy(j->err, (msg != NULL) ? msg : "", l + 1);
+        else
+            joberror(j, j->status, "not enough memory");
+    } else {
+        db.b = NULL;
+        db.n = db.size = 0;
+        if (het_dump(S, dumpjob, &db, HET_DUMPALIGNED) != 0) {
+            free(db.b);
+            joberror(j, HET_ERRMEM, "not enough memory");
+        } else {
+            free(j->base);
+            setjobdata(j, db.b, db.n);
+            j->compiled = 1;
+        }
+    }
+    het_settop(S, top);
+}
+
+/* 'S' is a scratch state to compile text chunks, or NULL */
+static void runjob(LoadJob *j, het_State *S) {
+    j->status = HET_OK;
+    if (readchunk(j) && checkmode(j)) {
+        if (j->size > 0 && j->data[0] == HET_SIGNATURE[0])
+            checkbinary(j);
+        else if (S != NULL)
+            compilejob(j, S);
+    }
+}
+
+/* create the function of a finished job in 'L' (on the calling thread) */
+static int finishjob(het_State *L, LoadJob *j) {
+    het_ChunkSource *src = j->src;
+    if (j->status == HET_OK)
+        src->status = het_load(L, getjob, j, src->chunkname,
+                               j->compiled ? "b" : src->mode);
+    else {
+        src->status = j->status;
+        if (j->err != NULL) /* message from the parser */
+            het_pushstring(L, j->err);
+        else
+            het_pushfstring(L, "%s: %s", src->chunkname, j->msg);
+    }
+    free(j->base);
+    free(j->err);
+    j->base = NULL;
+    j->err = NULL;
+    return src->status != HET_OK;
+}
+
+/*
+** {======================================================
+** Helper threads
+** =======================================================
+*/
+
+#if defined(HET_USE_POSIX)
+
+#define lockjobs(lm) pthread_mutex_lock(&(lm)->lock)
+#define unlockjobs(lm) pthread_mutex_unlock(&(lm)->lock)
+
+/* run the next job not yet started; return 0 if there is none */
+static int stepjob(LoadMany *lm, het_State *S) {
+    LoadJob *j;
+    lockjobs(lm);
+    if (lm->next >= lm->n) {
+        unlockjobs(lm);
+        return 0;
+    }
+    j = &lm->jobs[lm->next++];
+    unlockjobs(lm);
+    runjob(j, S);
+    lockjobs(lm);
+    j->done = 1;
+    pthread_cond_broadcast(&lm->cond);
+    unlockjobs(lm);
+    return 1;
+}
+
+/*
+** Scratch states have an allocator of their own, over malloc, as the
+** allocator of the loading state may not be usable from several
+** threads at once. Without a scratch state, text chunks are left to
+** 'het_load'.
+*/
+static void *scratchalloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+    (void)ud;
+    (void)osize;
+    if (nsize == 0) {
+        free(ptr);
+        return NULL;
+    }
+    return realloc(ptr, nsize);
+}
+
+static het_State *newscratch(void) {
+    return het_newstate(scratchalloc, NULL);
+}
+
+static void *helper(void *ud) {
+    LoadMany *lm = (LoadMany *)ud;
+    het_State *S = newscratch();
+    while (stepjob(lm, S)) {
+    }
+    if (S != NULL)
+        het_close(S);
+    return NULL;
+}
+
+/* wait until job 'i' is done, running other jobs meanwhile */
+static void waitjob(LoadMany *lm, int i, het_State **S) {
+    for (;;) {
+        int done, more;
+        lockjobs(lm);
+        done = lm->jobs[i].done;
+        more = (lm->next < lm->n);
+        unlockjobs(lm);
+        if (done || !more)
+            break;
+        if (*S == NULL)
+            *S = newscratch();
+        if (!stepjob(lm, *S))
+            break;
+    }
+    lockjobs(lm);
+    while (!lm->jobs[i].done)
+        pthread_cond_wait(&lm->cond, &lm->lock);
+    unlockjobs(lm);
+}
+
+static int loadjobs(het_State *L, LoadMany *lm, int nworkers) {
+    pthread_t *th = NULL;
+    het_State *S = NULL; /* scratch state of the calling thread */
+    int nth = 0, nfail = 0, i;
+    pthread_mutex_init(&lm->lock, NULL);
+    pthread_cond_init(&lm->cond, NULL);
+    if (nworkers > lm->n - 1)
+        nworkers = lm->n - 1; /* the calling thread runs jobs too */
+    if (nworkers > 0)
+        th = (pthread_t *)malloc(sizeof(pthread_t) * cast_sizet(nworkers));
+    if (th != NULL) { /* (without memory just run it serially) */
+        while (nth < nworkers && pthread_create(&th[nth], NULL, helper, lm) == 0)
+            nth++;
+    }
+    for (i = 0; i < lm->n; i++) {
+        waitjob(lm, i, &S);
+        nfail += finishjob(L, &lm->jobs[i]);
+    }
+    for (i = 0; i < nth; i++)
+        pthread_join(th[i], NULL);
+    free(th);
+    if (S != NULL)
+        het_close(S);
+    pthread_cond_destroy(&lm->cond);
+    pthread_mutex_destroy(&lm->lock);
+    return nfail;
+}
+
+#else
+
+static int loadjobs(het_State *L, LoadMany *lm, int nworkers) {
+    int nfail = 0, i;
+    (void)nworkers;
+    for (i = 0; i < lm->n; i++) {
+        runjob(&lm->jobs[i], NULL);
+        nfail += finishjob(L, &lm->jobs[i]);
+    }
+    return nfail;
+}
+
+#endif
+
+/* }====================================================== */
+
+int het_loadmany(het_State *L, het_ChunkSource *srcs, int n, int nworkers) {
+    LoadMany lm;
+    int i, nfail;
+    if (n <= 0)
+        return 0;
+    if (!het_checkstack(L, n))
+        return -1;
+    lm.jobs = (LoadJob *)calloc(cast_sizet(n), sizeof(LoadJob));
+    if (lm.jobs == NULL)
+        return -1;
+    lm.n = n;
+    lm.next = 0;
+    for (i = 0; i < n; i++)
+        lm.jobs[i].src = &srcs[i];
+    nfail = loadjobs(L, &lm, nworkers);
+    free(lm.jobs);
+    return nfail;
+}
@@ -0,0 +1,86 @@
+#define het_lock_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include <string.h>
+
+#include "het.h"
+#include "het_lock.h"
+
+#if defined(HET_USE_STATELOCK)
+
+#include "het_gcstats.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#define osyield() SwitchToThread()
+#elif defined(HET_USE_POSIX)
+#include <sched.h>
+#define osyield() sched_yield()
+#else
+#define osyield() ((void)0)
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+#define cpurelax() __builtin_ia32_pause()
+#else
+#define cpurelax() ((void)0)
+#endif
+
+/* tries spinning before yielding the processor between tries */
+#if !defined(HETI_LOCKSPIN)
+#define HETI_LOCKSPIN 200
+#endif
+
+#define trylock(l) \
+    (__atomic_load_n(&(l)->held, __ATOMIC_RELAXED) == 0 && \
+     __atomic_exchange_n(&(l)->held, 1, __ATOMIC_ACQUIRE) == 0)
+
+void hetE_initlock(StateLock *l) {
+    l->held = 0;
+    l->nwaiting = 0;
+    memset(&l->st, 0, sizeof(l->st));
+}
+
+/* slow path of 'hetE_lock': the lock was taken */
+void hetE_lockslow(StateLock *l) {
+    unsigned long start = hetC_clock();
+    unsigned long wait;
+    int i;
+    __atomic_add_fetch(&l->nwaiting, 1, __ATOMIC_RELAXED);
+    for (i = 0; !trylock(l); i++) {
+        if (i < HETI_LOCKSPIN)
+            cpurelax();
+        else
+            osyield();
+    }
+    __atomic_sub_fetch(&l->nwaiting, 1, __ATOMIC_RELAXED);
+    wait = hetC_clock() - start;
+    l->st.acquires++;
+    l->st.contended++;
+    l->st.waittime += wait;
+    if (wait > l->st.maxwait)
+        l->st.maxwait = wait;
+}
+
+/*
+** Let a waiting thread in: without yielding the processor, the holder
+** would usually take the lock back before any waiter noticed it free.
+*/
+void hetE_handoff(StateLock *l) {
+    l->st.handoffs++;
+    hetE_unlock(l);
+    osyield();
+    hetE_lock(l);
+}
+
+/* must be called with the lock held */
+void hetE_lockstats(StateLock *l, het_LockStats *st, int reset) {
+    if (st != NULL)
+        *st = l->st;
+    if (reset)
+        memset(&l->st, 0, sizeof(l->st));
+}
+
+#endif
@@ -0,0 +1,98 @@
+#define het_mapfile_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "het.h"
+#include "het_mapfile.h"
+
+#if defined(HET_USE_POSIX)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int mapit(het_MappedFile *mf, const char *path) {
+    struct stat st;
+    void *p;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) { /* cannot map 0 bytes */
+        close(fd);
+        return 0;
+    }
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); /* the mapping keeps its own reference */
+    if (p == MAP_FAILED)
+        return 0;
+    mf->data = (const char *)p;
+    mf->size = (size_t)st.st_size;
+    mf->mapped = 1;
+    return 1;
+}
+
+static void unmapit(het_MappedFile *mf) {
+    munmap((void *)mf->data, mf->size);
+}
+
+#else
+
+#define mapit(mf,path) ((void)(mf), (void)(path), 0)
+#define unmapit(mf) ((void)(mf))
+
+#endif
+
+/* fallback: read the whole file into a heap buffer */
+static int readit(het_MappedFile *mf, const char *path) {
+    char *buff = NULL;
+    size_t n = 0;
+    size_t size = BUFSIZ;
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return 0;
+    for (;;) {
+        char *nb = (char *)realloc(buff, size);
+        if (nb == NULL)
+            break;
+        buff = nb;
+        n += fread(buff + n, 1, size - n, f);
+        if (n < size) { /* end of file (or error)? */
+            if (ferror(f))
+                break;
+            fclose(f);
+            mf->data = buff;
+            mf->size = n;
+            mf->mapped = 0;
+            return 1;
+        }
+        size *= 2;
+    }
+    free(buff);
+    fclose(f);
+    return 0;
+}
+
+const char *het_mapfile(het_MappedFile *mf, const char *path) {
+    if (!mapit(mf, path) && !readit(mf, path)) {
+        mf->data = NULL;
+        mf->size = 0;
+        mf->mapped = 0;
+    }
+    return mf->data;
+}
+
+void het_unmapfile(het_MappedFile *mf) {
+    if (mf->data == NULL)
+        return;
+    if (mf->mapped)
+        unmapit(mf);
+    else
+        free((void *)mf->data);
+    mf->data = NULL;
+    mf->size = 0;
+}
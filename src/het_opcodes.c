@@ -91,5 +91,56 @@ HETI_DDEF const he_byte hetP_opmodes[NUM_OPCODES] = {
  ,opmode(0, 0, 0, 0, 1, iABx)           /* OP_CLOSURE */
  ,opmode(0, 1, 0, 0, 1, iABC)           /* OP_VARARG */
  ,opmode(0, 0, 1, 0, 1, iABC)           /* OP_VARARGPREP */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_GETFIELDCALL */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_ADDIINT */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_ADDIFLT */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_ADDKINT */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_ADDKFLT */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_SUBKINT */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_SUBKFLT */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_MULKINT */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_MULKFLT */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_ADDINT */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_ADDFLT */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_SUBINT */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_SUBFLT */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_MULINT */
+ ,opmode(0, 0, 0, 0, 1, iABC)           /* OP_MULFLT */
+ ,opmode(0, 0, 0, 0, 1, iABx)           /* OP_FORLOOPI */
  ,opmode(0, 0, 0, 0, 0, iAx)            /* OP_EXTRAARG */
-};
\ No newline at end of file
+};
+
+/* ORDER OP */
+
+HETI_DDEF const he_byte hetP_opbase[NUM_OPCODES] = {
+  OP_MOVE, OP_LOADI, OP_LOADF, OP_LOADK, OP_LOADKX, OP_LOADFALSE,
+  OP_LFALSESKIP, OP_LOADTRUE, OP_LOADNIL, OP_GETUPVAL, OP_SETUPVAL,
+  OP_GETTABUP, OP_GETTABLE, OP_GETI, OP_GETFIELD, OP_SETTABUP,
+  OP_SETTABLE, OP_SETI, OP_SETFIELD, OP_NEWTABLE, OP_SELF, OP_ADDI,
+  OP_ADDK, OP_SUBK, OP_MULK, OP_MODK, OP_POWK, OP_DIVK, OP_IDIVK,
+  OP_BANDK, OP_BORK, OP_BXORK, OP_SHRI, OP_SHLI, OP_ADD, OP_SUB, OP_MUL,
+  OP_MOD, OP_POW, OP_DIV, OP_IDIV, OP_BAND, OP_BOR, OP_BXOR, OP_SHL,
+  OP_SHR, OP_MMBIN, OP_MMBINI, OP_MMBINK, OP_UNM, OP_BNOT, OP_NOT,
+  OP_LEN, OP_CONCAT, OP_CLOSE, OP_TBC, OP_JMP, OP_EQ, OP_LT, OP_LE,
+  OP_EQK, OP_EQI, OP_LTI, OP_LEI, OP_GTI, OP_GEI, OP_TEST, OP_TESTSET,
+  OP_CALL, OP_TAILCALL, OP_RETURN, OP_RETURN0, OP_RETURN1, OP_FORLOOP,
+  OP_FORPREP, OP_TFORPREP, OP_TFORCALL, OP_TFORLOOP, OP_SETLIST,
+  OP_CLOSURE, OP_VARARG, OP_VARARGPREP,
+  OP_GETFIELD /* OP_GETFIELDCALL */,
+  OP_ADDI /* OP_ADDIINT */,
+  OP_ADDI /* OP_ADDIFLT */,
+  OP_ADDK /* OP_ADDKINT */,
+  OP_ADDK /* OP_ADDKFLT */,
+  OP_SUBK /* OP_SUBKINT */,
+  OP_SUBK /* OP_SUBKFLT */,
+  OP_MULK /* OP_MULKINT */,
+  OP_MULK /* OP_MULKFLT */,
+  OP_ADD /* OP_ADDINT */,
+  OP_ADD /* OP_ADDFLT */,
+  OP_SUB /* OP_SUBINT */,
+  OP_SUB /* OP_SUBFLT */,
+  OP_MUL /* OP_MULINT */,
+  OP_MUL /* OP_MULFLT */,
+  OP_FORLOOP /* OP_FORLOOPI */,
+  OP_EXTRAARG
+};
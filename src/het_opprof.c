@@ -0,0 +1,185 @@
+#define het_opprof_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "het.h"
+#include "het_debug.h"
+#include "het_opcodes.h"
+#include "het_opnames.h"
+#include "het_opprof.h"
+
+#if defined(HET_USE_OPPROFILE)
+
+/*
+** Counts are allocated outside the state allocator, so that profiling
+** does not change the pace of the collector. Without memory a function
+** is simply not counted.
+*/
+void hetG_newopcount(Proto *p) {
+    if (p->opcount == NULL && p->sizecode > 0)
+        p->opcount = (unsigned long *)calloc(cast_sizet(p->sizecode),
+                                             sizeof(unsigned long));
+}
+
+void hetG_freeopcount(Proto *p) {
+    free(p->opcount);
+    p->opcount = NULL;
+}
+
+/* clear the counts of 'p' and of its nested functions */
+void hetG_resetopcount(Proto *p) {
+    int i;
+    if (p->opcount != NULL) {
+        for (i = 0; i < p->sizecode; i++)
+            p->opcount[i] = 0;
+    }
+    for (i = 0; i < p->sizep; i++)
+        hetG_resetopcount(p->p[i]);
+}
+
+/*
+** {======================================================
+** Dump
+** =======================================================
+*/
+
+typedef struct HotSpot {
+    const Proto *p;
+    int pc;
+    unsigned long count;
+} HotSpot;
+
+typedef struct DumpState {
+    het_State *L;
+    het_Writer writer;
+    void *data;
+    int status;
+    unsigned long total; /* all executed instructions */
+    unsigned long opcount[NUM_OPCODES]; /* executions per opcode */
+    HotSpot *spots;
+    size_t nspots;
+} DumpState;
+
+static void put(DumpState *D, const char *fmt, ...) {
+    char buff[HET_IDSIZE + 80];
+    int n;
+    va_list argp;
+    if (D->status != 0)
+        return;
+    va_start(argp, fmt);
+    n = vsnprintf(buff, sizeof(buff), fmt, argp);
+    va_end(argp);
+    if (n > 0) {
+        size_t l = (cast_sizet(n) < sizeof(buff)) ? cast_sizet(n)
+                                                  : sizeof(buff) - 1;
+        D->status = (*D->writer)(D->L, buff, l, D->data);
+    }
+}
+
+/* add up the counts of 'p' and its nested functions ('spots' if given) */
+static void collect(DumpState *D, const Proto *p) {
+    int i;
+    if (p->opcount != NULL) {
+        for (i = 0; i < p->sizecode; i++) {
+            unsigned long c = p->opcount[i];
+            if (c == 0)
+                continue;
+            D->opcount[GET_OPCODE(p->code[i])] += c;
+            D->total += c;
+            if (D->spots != NULL) {
+                D->spots[D->nspots].p = p;
+                D->spots[D->nspots].pc = i;
+                D->spots[D->nspots].count = c;
+            }
+            D->nspots++;
+        }
+    }
+    for (i = 0; i < p->sizep; i++)
+        collect(D, p->p[i]);
+}
+
+static int cmpspots(const void *a, const void *b) {
+    unsigned long ca = cast(const HotSpot *, a)->count;
+    unsigned long cb = cast(const HotSpot *, b)->count;
+    return (ca < cb) - (ca > cb); /* descending */
+}
+
+static double percent(DumpState *D, unsigned long c) {
+    return (D->total == 0) ? 0.0 : 100.0 * cast(double, c) / cast(double, D->total);
+}
+
+static void dumpopcodes(DumpState *D) {
+    int order[NUM_OPCODES];
+    int i, j;
+    for (i = 0; i < NUM_OPCODES; i++) { /* insertion sort, descending */
+        for (j = i; j > 0 && D->opcount[order[j - 1]] < D->opcount[i]; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+    put(D, "opcode\tcount\t%%\n");
+    for (i = 0; i < NUM_OPCODES && D->opcount[order[i]] > 0; i++)
+        put(D, "%s\t%lu\t%.2f\n", opnames[order[i]], D->opcount[order[i]],
+            percent(D, D->opcount[order[i]]));
+}
+
+static void dumpspots(DumpState *D, size_t nhot) {
+    size_t i;
+    put(D, "\nsource:line\tpc\topcode\tcount\t%%\n");
+    for (i = 0; i < D->nspots && i < nhot; i++) {
+        const HotSpot *s = &D->spots[i];
+        const char *src = (s->p->source != NULL) ? getstr(s->p->source) : "=?";
+        if (*src == '@' || *src == '=')
+            src++;
+        put(D, "%.*s:%d\t%d\t%s\t%lu\t%.2f\n", HET_IDSIZE, src,
+            hetG_getfuncline(s->p, s->pc), s->pc + 1,
+            opnames[GET_OPCODE(s->p->code[s->pc])], s->count,
+            percent(D, s->count));
+    }
+}
+
+/*
+** Write, as tab-separated text, the executions of each opcode in 'p'
+** and its nested functions, from most to least executed, followed by
+** the 'nhot' most executed instructions (all of them if 'nhot' <= 0)
+** with their source lines. Returns the first error from the writer,
+** or HET_ERRMEM.
+*/
+int hetG_dumpopcount(het_State *L, const Proto *p, int nhot, het_Writer w,
+                     void *ud) {
+    DumpState D;
+    int i;
+    D.L = L;
+    D.writer = w;
+    D.data = ud;
+    D.status = 0;
+    D.total = 0;
+    for (i = 0; i < NUM_OPCODES; i++)
+        D.opcount[i] = 0;
+    D.spots = NULL;
+    D.nspots = 0;
+    collect(&D, p); /* first pass: totals and number of spots */
+    if (D.nspots > 0) {
+        D.spots = (HotSpot *)malloc(D.nspots * sizeof(HotSpot));
+        if (D.spots == NULL)
+            return HET_ERRMEM;
+        D.total = 0;
+        for (i = 0; i < NUM_OPCODES; i++)
+            D.opcount[i] = 0;
+        D.nspots = 0;
+        collect(&D, p); /* second pass: fill spots */
+        qsort(D.spots, D.nspots, sizeof(HotSpot), cmpspots);
+    }
+    dumpopcodes(&D);
+    dumpspots(&D, (nhot <= 0) ? D.nspots : cast_sizet(nhot));
+    free(D.spots);
+    return D.status;
+}
+
+/* }====================================================== */
+
+#endif
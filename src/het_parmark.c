@@ -0,0 +1,314 @@
+#define het_parmark_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "het.h"
+#include "het_parmark.h"
+
+#if defined(HET_USE_PARMARK)
+
+#if defined(HET_USE_POSIX)
+#include <pthread.h>
+#include <sched.h>
+#define osyield() sched_yield()
+#else
+#define osyield() ((void)0)
+#endif
+
+#define load(p, mo) __atomic_load_n(p, __ATOMIC_##mo)
+#define store(p, v, mo) __atomic_store_n(p, v, __ATOMIC_##mo)
+#define fence(mo) __atomic_thread_fence(__ATOMIC_##mo)
+#define casidx(p, o, n) \
+    __atomic_compare_exchange_n(p, &(o), n, 0, __ATOMIC_SEQ_CST, \
+                                __ATOMIC_RELAXED)
+
+/* initial size of each gray deque */
+#define MINGRAYSIZE 1024
+
+#define slot(a, i) (&(a)->item[(i) & ((a)->size - 1)])
+
+static GrayArray *newarray(long size) {
+    GrayArray *a = (GrayArray *)malloc(offsetof(GrayArray, item) +
+                                       cast_sizet(size) * sizeof(GCObject *));
+    if (a != NULL) {
+        a->old = NULL;
+        a->size = size;
+    }
+    return a;
+}
+
+int hetC_pminit(ParMark *pm, int n, he_byte whites, ParTraverse traverse,
+                void *ud) {
+    int i;
+    pm->wk = (GrayWorker *)calloc(cast_sizet(n), sizeof(GrayWorker));
+    if (pm->wk == NULL)
+        return 0;
+    pm->n = n;
+    for (i = 0; i < n; i++) {
+        if ((pm->wk[i].a = newarray(MINGRAYSIZE)) == NULL) {
+            hetC_pmfree(pm);
+            return 0;
+        }
+    }
+    pm->nstarted = pm->nidle = pm->nextroot = 0;
+    pm->whites = whites;
+    pm->traverse = traverse;
+    pm->ud = ud;
+    return 1;
+}
+
+void hetC_pmfree(ParMark *pm) {
+    int i;
+    for (i = 0; i < pm->n; i++) {
+        GrayArray *a = pm->wk[i].a;
+        while (a != NULL) {
+            GrayArray *old = a->old;
+            free(a);
+            a = old;
+        }
+    }
+    free(pm->wk);
+    pm->wk = NULL;
+    pm->n = 0;
+}
+
+/*
+** {======================================================
+** Work-stealing deques
+** =======================================================
+*/
+
+/*
+** Only the owner pushes and takes (at 'bottom'); thieves steal at
+** 'top'. A full deque moves to an array twice as big; thieves may still
+** be reading the old one, so it is freed only at the end.
+*/
+static GrayArray *grow(GrayWorker *gw, GrayArray *a, long t, long b) {
+    GrayArray *na = newarray(a->size * 2);
+    long i;
+    if (na == NULL)
+        return NULL;
+    for (i = t; i < b; i++)
+        *slot(na, i) = *slot(a, i);
+    na->old = a;
+    store(&gw->a, na, RELEASE);
+    return na;
+}
+
+static int push(GrayWorker *gw, GCObject *o) {
+    long b = load(&gw->bottom, RELAXED);
+    long t = load(&gw->top, ACQUIRE);
+    GrayArray *a = load(&gw->a, RELAXED);
+    if (b - t > a->size - 1 && (a = grow(gw, a, t, b)) == NULL)
+        return 0;
+    store(slot(a, b), o, RELAXED);
+    fence(RELEASE);
+    store(&gw->bottom, b + 1, RELAXED);
+    return 1;
+}
+
+static GCObject *take(GrayWorker *gw) {
+    long b = load(&gw->bottom, RELAXED) - 1;
+    GrayArray *a = load(&gw->a, RELAXED);
+    long t;
+    GCObject *o = NULL;
+    store(&gw->bottom, b, RELAXED);
+    fence(SEQ_CST);
+    t = load(&gw->top, RELAXED);
+    if (t <= b) { /* not empty? */
+        o = load(slot(a, b), RELAXED);
+        if (t == b) { /* last one? race against thieves */
+            if (!casidx(&gw->top, t, t + 1))
+                o = NULL; /* a thief got it */
+            store(&gw->bottom, b + 1, RELAXED);
+        }
+    } else
+        store(&gw->bottom, b + 1, RELAXED);
+    return o;
+}
+
+static GCObject *steal(GrayWorker *gw) {
+    long t = load(&gw->top, ACQUIRE);
+    long b;
+    fence(SEQ_CST);
+    b = load(&gw->bottom, ACQUIRE);
+    if (t < b) {
+        GrayArray *a = load(&gw->a, ACQUIRE);
+        GCObject *o = load(slot(a, t), RELAXED);
+        if (casidx(&gw->top, t, t + 1))
+            return o;
+    }
+    return NULL;
+}
+
+static int dequeempty(GrayWorker *gw) {
+    return load(&gw->top, ACQUIRE) >= load(&gw->bottom, ACQUIRE);
+}
+
+/* }====================================================== */
+
+/* clear the white bits of 'o'; true if this call did it */
+static int claim(GCObject *o, he_byte whites) {
+    he_byte m = load(&o->marked, RELAXED);
+    while (m & whites) {
+        if (__atomic_compare_exchange_n(&o->marked, &m,
+                                        cast_byte(m & ~whites), 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            return 1;
+    }
+    return 0;
+}
+
+/*
+** Mark 'o' gray for worker 'w'. Without memory for a bigger deque, the
+** object is traversed right away (recursively), which is slower but
+** still correct.
+*/
+void hetC_pmmark(ParMark *pm, int w, GCObject *o) {
+    if (claim(o, pm->whites) && !push(&pm->wk[w], o))
+        pm->wk[w].traversed += pm->traverse(pm, w, o);
+}
+
+/* mark a root, spreading roots over the workers (before 'hetC_parmark') */
+void hetC_pmroot(ParMark *pm, GCObject *o) {
+    hetC_pmmark(pm, pm->nextroot, o);
+    pm->nextroot = (pm->nextroot + 1) % pm->n;
+}
+
+static GCObject *stealany(ParMark *pm, int w) {
+    int i;
+    for (i = 1; i < pm->n; i++) {
+        GCObject *o = steal(&pm->wk[(w + i) % pm->n]);
+        if (o != NULL)
+            return o;
+    }
+    return NULL;
+}
+
+static int anywork(ParMark *pm) {
+    int i;
+    for (i = 0; i < pm->n; i++) {
+        if (!dequeempty(&pm->wk[i]))
+            return 1;
+    }
+    return 0;
+}
+
+/*
+** A worker out of work is idle. The mark ends when all started workers
+** are idle and every deque is empty: an idle worker holds no object and
+** has emptied its own deque, and only owners push. ('nidle' is read
+** before 'nstarted', which only grows, so equal counts mean all
+** started workers were idle at once.) Workers that start late find
+** nothing to do, so a runner may run them in any order, even serially.
+*/
+/*
+** Claim the index of a new worker; -1 if all 'n' have started (extra
+** calls from the runner must not count as started workers, or the
+** others would wait for them forever).
+*/
+static int claimworker(ParMark *pm) {
+    int w = load(&pm->nstarted, SEQ_CST);
+    while (w < pm->n) {
+        if (__atomic_compare_exchange_n(&pm->nstarted, &w, w + 1, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+            return w;
+    }
+    return -1;
+}
+
+static void worker(void *arg) {
+    ParMark *pm = (ParMark *)arg;
+    int w = claimworker(pm);
+    GrayWorker *gw;
+    if (w < 0)
+        return; /* runner called too many workers */
+    gw = &pm->wk[w];
+    for (;;) {
+        GCObject *o;
+        int spins = 0;
+        while ((o = take(gw)) != NULL || (o = stealany(pm, w)) != NULL)
+            gw->traversed += pm->traverse(pm, w, o);
+        __atomic_add_fetch(&pm->nidle, 1, __ATOMIC_SEQ_CST);
+        for (;;) {
+            if (anywork(pm)) {
+                __atomic_sub_fetch(&pm->nidle, 1, __ATOMIC_SEQ_CST);
+                break;
+            }
+            if (load(&pm->nidle, SEQ_CST) == load(&pm->nstarted, SEQ_CST))
+                return; /* mark is done */
+            if (++spins > 64)
+                osyield();
+        }
+    }
+}
+
+/*
+** Run the mark with the runner 'f' (or 'hetC_runthreads'); returns the
+** number of bytes traversed.
+*/
+size_t hetC_parmark(ParMark *pm, het_GCRunner f, void *ud) {
+    size_t traversed = 0;
+    int i;
+    pm->nstarted = pm->nidle = 0;
+    if (f == NULL)
+        f = hetC_runthreads;
+    (*f)(ud, worker, pm, pm->n);
+    if (pm->nstarted == 0) /* runner did nothing? */
+        worker(pm);
+    het_assert(!anywork(pm));
+    for (i = 0; i < pm->n; i++)
+        traversed += pm->wk[i].traversed;
+    return traversed;
+}
+
+/*
+** Default runner: 'n - 1' new threads plus the calling one. Threads
+** that cannot be created are simply not there (see 'worker').
+*/
+#if defined(HET_USE_POSIX)
+
+typedef struct RunWork {
+    void (*work)(void *arg);
+    void *arg;
+} RunWork;
+
+static void *runwork(void *ud) {
+    RunWork *rw = (RunWork *)ud;
+    rw->work(rw->arg);
+    return NULL;
+}
+
+#endif
+
+void hetC_runthreads(void *ud, void (*work)(void *arg), void *arg, int n) {
+#if defined(HET_USE_POSIX)
+    pthread_t *th = NULL;
+    RunWork rw;
+    int nth = 0, i;
+    (void)ud;
+    rw.work = work;
+    rw.arg = arg;
+    if (n > 1)
+        th = (pthread_t *)malloc(sizeof(pthread_t) * cast_sizet(n - 1));
+    if (th != NULL) {
+        while (nth < n - 1 &&
+               pthread_create(&th[nth], NULL, runwork, &rw) == 0)
+            nth++;
+    }
+    work(arg);
+    for (i = 0; i < nth; i++)
+        pthread_join(th[i], NULL);
+    free(th);
+#else
+    (void)ud;
+    (void)n;
+    work(arg);
+#endif
+}
+
+#endif
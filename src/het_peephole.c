@@ -0,0 +1,46 @@
+#define het_peephole_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include "het_peephole.h"
+
+/* can instruction 'i', followed by 'next', become a superinstruction? */
+static int canfuse(Instruction i, Instruction next) {
+    switch (GET_OPCODE(i)) {
+        case OP_GETFIELD: /* R[A] := R[B][K[C]]; R[A](...) */
+            return GET_OPCODE(next) == OP_CALL && GETARG_A(next) == GETARG_A(i);
+        default:
+            return 0;
+    }
+}
+
+static OpCode fusedop(OpCode op) {
+    switch (op) {
+        case OP_GETFIELD: return OP_GETFIELDCALL;
+        default: het_assert(0); return op;
+    }
+}
+
+void hetP_fuse(Proto *f, FuseStats *st) {
+    int pc, ninstr = 0, nfused = 0;
+    if (!(f->flag & PF_FIXED)) {
+        ninstr = f->sizecode;
+        /* the second instruction of a pair is kept, so jumps into the
+           middle of a pair still work */
+        for (pc = 0; pc + 1 < f->sizecode; pc++) {
+            Instruction *i = &f->code[pc];
+            if (canfuse(*i, *(i + 1))) {
+                SET_OPCODE(*i, fusedop(GET_OPCODE(*i)));
+                het_assert(baseopcode(GET_OPCODE(*i)) != GET_OPCODE(*i));
+                nfused++;
+            }
+        }
+    }
+    if (st != NULL) {
+        st->ninstr += cast(unsigned long, ninstr);
+        st->nfused += cast(unsigned long, nfused);
+    }
+    for (pc = 0; pc < f->sizep; pc++)
+        hetP_fuse(f->p[pc], st);
+}
@@ -0,0 +1,247 @@
+#define het_sampler_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "het.h"
+#include "het_debug.h"
+#include "het_gcstats.h"
+#include "het_sampler.h"
+
+#define slot(s, i) (&(s)->ring[(i) & ((s)->size - 1)])
+
+/* frame of a prototype freed since it was sampled */
+static const char collectedtag = 0;
+#define COLLECTED cast(const Proto *, &collectedtag)
+
+/* the ring must hold at least one whole sample besides the one being
+   recorded, so that recording never drops itself */
+#define MINSLOTS (2 * (HET_SAMPLEDEPTH + 1))
+
+/*
+** Samplers live outside the state allocator, as they must not allocate
+** (nor run the collector) while sampling.
+*/
+Sampler *hetG_newsampler(unsigned int nslots, int period,
+                         unsigned long interval) {
+    Sampler *s;
+    unsigned int size = 1;
+    while ((size < MINSLOTS || size < nslots) && size <= UINT_MAX / 2)
+        size *= 2;
+    s = (Sampler *)malloc(sizeof(Sampler));
+    if (s == NULL)
+        return NULL;
+    s->ring = (SampleSlot *)malloc(size * sizeof(SampleSlot));
+    if (s->ring == NULL) {
+        free(s);
+        return NULL;
+    }
+    s->size = size;
+    s->head = s->tail = s->cur = 0;
+    s->period = (period > 0) ? period : 1;
+    s->countdown = s->period;
+    s->interval = interval;
+    s->last = hetC_clock();
+    s->nsamples = s->ndropped = 0;
+    return s;
+}
+
+void hetG_freesampler(Sampler *s) {
+    if (s != NULL) {
+        free(s->ring);
+        free(s);
+    }
+}
+
+/* slow path of 'hetG_sampletick' */
+int hetG_sampledue(Sampler *s) {
+    s->countdown = s->period;
+    if (s->interval != 0) {
+        unsigned long now = hetC_clock();
+        if (now - s->last < s->interval)
+            return 0;
+        s->last = now;
+    }
+    return 1;
+}
+
+/* get the next free slot, dropping the oldest sample if needed */
+static SampleSlot *newslot(Sampler *s) {
+    if (s->tail - s->head == s->size) { /* ring is full? */
+        het_assert(s->head != s->cur);
+        s->head += slot(s, s->head)->n + 1;
+        s->ndropped++;
+    }
+    return slot(s, s->tail++);
+}
+
+void hetG_samplebegin(Sampler *s) {
+    s->cur = s->tail;
+    newslot(s)->n = 0;
+}
+
+void hetG_sampleframe(Sampler *s, Proto *p, int pc) {
+    SampleSlot *f;
+    if (slot(s, s->cur)->n >= HET_SAMPLEDEPTH)
+        return; /* too deep; cut outer frames */
+    if (p != NULL)
+        p->flag |= PF_SAMPLED;
+    f = newslot(s);
+    f->f.p = p;
+    f->f.pc = pc;
+    slot(s, s->cur)->n++;
+}
+
+void hetG_sampleend(Sampler *s) {
+    s->nsamples++;
+}
+
+/* mark the frames of prototype 'p', which is being freed */
+void hetG_sampleforget(Sampler *s, const Proto *p) {
+    unsigned int x, k;
+    for (x = s->head; x != s->tail; x += slot(s, x)->n + 1) {
+        for (k = 1; k <= slot(s, x)->n; k++) {
+            SampleSlot *f = slot(s, x + k);
+            if (f->f.p == p)
+                f->f.p = COLLECTED;
+        }
+    }
+}
+
+/*
+** {======================================================
+** Folded stacks
+** =======================================================
+*/
+
+/*
+** 'hetG_dumpsamples' writes the samples in the "folded stacks" format
+** of flame graph tools, one line per distinct stack:
+**
+**   outer;...;inner count
+**
+** Each frame is "source:line", where line is the current line if
+** 'lines' is true or the line where the function was defined. Then the
+** ring is emptied. Identical stacks are grouped by sorting the samples,
+** so this allocates (unlike sampling). Returns the first error from the
+** writer, or HET_ERRMEM.
+*/
+
+/* frame 'i' of the sample with header 'h', counting from the outermost */
+#define frame(s, h, i) (&slot(s, (h) + slot(s, h)->n - (i))->f)
+
+static int cmpframes(Sampler *s, unsigned int a, unsigned int b) {
+    unsigned int na = slot(s, a)->n, nb = slot(s, b)->n;
+    unsigned int i;
+    for (i = 0; i < na && i < nb; i++) {
+        H_P2I pa = cast(H_P2I, frame(s, a, i)->p);
+        H_P2I pb = cast(H_P2I, frame(s, b, i)->p);
+        int la = frame(s, a, i)->pc, lb = frame(s, b, i)->pc;
+        if (pa != pb)
+            return (pa < pb) ? -1 : 1;
+        if (la != lb)
+            return (la < lb) ? -1 : 1;
+    }
+    return (na > i) - (nb > i); /* a prefix comes first */
+}
+
+/* bottom-up merge sort of the sample headers 'h' ('tmp' is scratch) */
+static void sortsamples(Sampler *s, unsigned int *h, unsigned int *tmp,
+                        size_t n) {
+    size_t w, i;
+    for (w = 1; w < n; w *= 2) {
+        for (i = 0; i < n; i += 2 * w) {
+            size_t lo = i, mid = (i + w < n) ? i + w : n;
+            size_t hi = (i + 2 * w < n) ? i + 2 * w : n;
+            size_t a = lo, b = mid, k = lo;
+            while (a < mid && b < hi)
+                tmp[k++] = (cmpframes(s, h[b], h[a]) < 0) ? h[b++] : h[a++];
+            while (a < mid)
+                tmp[k++] = h[a++];
+            while (b < hi)
+                tmp[k++] = h[b++];
+        }
+        memcpy(h, tmp, n * sizeof(unsigned int));
+    }
+}
+
+typedef struct DumpState {
+    het_State *L;
+    het_Writer writer;
+    void *data;
+    int status;
+} DumpState;
+
+static void dumpbuff(DumpState *D, const char *b, size_t l) {
+    if (D->status == 0)
+        D->status = (*D->writer)(D->L, b, l, D->data);
+}
+
+static void writestack(DumpState *D, Sampler *s, unsigned int h,
+                       unsigned long count) {
+    char buff[HET_IDSIZE + 40];
+    unsigned int i, n = slot(s, h)->n;
+    for (i = 0; i < n; i++) {
+        const Proto *p = frame(s, h, i)->p;
+        int l;
+        if (p == NULL)
+            l = snprintf(buff, sizeof(buff), "%s[C]", (i > 0) ? ";" : "");
+        else if (p == COLLECTED)
+            l = snprintf(buff, sizeof(buff), "%s[collected]",
+                         (i > 0) ? ";" : "");
+        else {
+            const char *src = (p->source != NULL) ? getstr(p->source) : "=?";
+            if (*src == '@' || *src == '=')
+                src++;
+            l = snprintf(buff, sizeof(buff), "%s%.*s:%d", (i > 0) ? ";" : "",
+                         HET_IDSIZE, src, frame(s, h, i)->pc);
+        }
+        dumpbuff(D, buff, cast_sizet(l));
+    }
+    dumpbuff(D, buff, cast_sizet(snprintf(buff, sizeof(buff), " %lu\n", count)));
+}
+
+int hetG_dumpsamples(het_State *L, Sampler *s, int lines, het_Writer w,
+                     void *ud) {
+    DumpState D;
+    unsigned int *h, *tmp;
+    unsigned int x;
+    size_t n = 0, i, j;
+    for (x = s->head; x != s->tail; x += slot(s, x)->n + 1)
+        n++;
+    h = (unsigned int *)malloc((2 * n + 1) * sizeof(unsigned int));
+    if (h == NULL)
+        return HET_ERRMEM;
+    tmp = h + n;
+    for (i = 0, x = s->head; x != s->tail; x += slot(s, x)->n + 1) {
+        unsigned int k;
+        h[i++] = x;
+        for (k = 1; k <= slot(s, x)->n; k++) { /* replace pcs by lines */
+            SampleSlot *f = slot(s, x + k);
+            if (f->f.p == NULL || f->f.p == COLLECTED)
+                f->f.pc = 0;
+            else
+                f->f.pc = lines ? hetG_getfuncline(f->f.p, f->f.pc)
+                                : f->f.p->linedefined;
+        }
+    }
+    sortsamples(s, h, tmp, n);
+    D.L = L;
+    D.writer = w;
+    D.data = ud;
+    D.status = 0;
+    for (i = 0; i < n; i = j) { /* write each run of equal stacks */
+        for (j = i + 1; j < n && cmpframes(s, h[i], h[j]) == 0; j++) {
+        }
+        writestack(&D, s, h[i], cast(unsigned long, j - i));
+    }
+    free(h);
+    s->head = s->tail = s->cur = 0;
+    return D.status;
+}
+
+/* }====================================================== */
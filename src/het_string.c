@@ -0,0 +1,255 @@
+#define het_string_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "het.h"
+#include "het_string.h"
+
+unsigned int hetS_hash(const char *str, size_t l, unsigned int seed) {
+    unsigned int h = seed ^ cast_uint(l);
+    for (; l > 0; l--)
+        h ^= ((h << 5) + (h >> 2) + cast_byte(str[l - 1]));
+    return h;
+}
+
+/*
+** {======================================================
+** Shared string pool
+** =======================================================
+*/
+
+/*
+** The pool lets every state in the process share the same immutable
+** short strings (reserved words, metamethod names, library names,
+** constants of preloaded chunks), so that a new worker state does not
+** intern and hash them again.
+**
+** The pool is filled before states use it: the first state that
+** takes the shared seed ('hetS_usepool') seals it, and later strings
+** are refused. Otherwise a state could intern a string in its own
+** table before the pool got it, and then find the pool copy too.
+**
+** Readers never lock: the pool is an open-addressing table; a writer
+** (writers are serialized by 'writing') grows it by building a bigger
+** copy and publishing it with a release store; older copies may still
+** be in use by readers, so they are kept in the 'previous' list until
+** 'het_releasestrings'.
+**
+** Pool strings are not linked in any state's object list and have only
+** SHAREDBIT in their 'marked' field (neither white nor black), so
+** collectors never mark or free them, as with fixed objects.
+*/
+
+typedef struct SharedTable {
+    struct SharedTable *previous; /* older versions, freed at release */
+    unsigned int size; /* number of slots (power of 2) */
+    unsigned int nuse; /* number of strings */
+    TString *slot[1];
+} SharedTable;
+
+#if defined(__GNUC__)
+#define atomicload(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define atomicstore(p,v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define atomicxchg(p,v) __atomic_exchange_n(p, v, __ATOMIC_ACQUIRE)
+#define atomiccas(p,o,n) \
+    __atomic_compare_exchange_n(p, o, n, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else /* no atomics: the pool must be filled before other threads start */
+#define atomicload(p) (*(p))
+#define atomicstore(p,v) (*(p) = (v))
+#define atomicxchg(p,v) (*(p) = (v), 0)
+#define atomiccas(p,o,n) (*(p) == *(o) ? (*(p) = (n), 1) : (*(o) = *(p), 0))
+#endif
+
+static SharedTable *shared = NULL;
+static int writing = 0;
+static int sealed = 0; /* set (by the writer) when a state uses the pool */
+static unsigned int sharedseed = 0;
+
+#define sizesharedtable(n) \
+    (offsetof(SharedTable, slot) + (n) * sizeof(TString *))
+
+/* minimum number of slots of the pool table */
+#define MINSHAREDSIZE 256
+
+/*
+** The seed is chosen once per process. Zero means "not chosen yet", so
+** a computed seed of zero is replaced.
+*/
+static unsigned int sharedseed_(void) {
+    unsigned int seed = atomicload(&sharedseed);
+    if (seed == 0) {
+        unsigned int expected = 0;
+        seed = point2uint(&sharedseed) ^ cast_uint(time(NULL));
+        if (seed == 0)
+            seed = 1;
+        if (!atomiccas(&sharedseed, &expected, seed))
+            seed = expected; /* another thread chose it first */
+    }
+    return seed;
+}
+
+#define lockwriter() while (atomicxchg(&writing, 1)) { /* writers are rare */ }
+#define unlockwriter() atomicstore(&writing, 0)
+
+/*
+** Seal the pool and return its seed. A state that uses the pool must
+** call it before interning any string.
+*/
+unsigned int hetS_usepool(void) {
+    if (!atomicload(&sealed)) {
+        lockwriter(); /* wait for a writer in progress */
+        atomicstore(&sealed, 1);
+        unlockwriter();
+    }
+    return sharedseed_();
+}
+
+static TString *lookup(SharedTable *tb, const char *str, size_t l,
+                       unsigned int h) {
+    unsigned int i = h & (tb->size - 1);
+    TString *ts;
+    while ((ts = atomicload(&tb->slot[i])) != NULL) {
+        if (ts->hash == h && ts->shrlen == l &&
+            memcmp(getstr(ts), str, l * sizeof(char)) == 0)
+            return ts;
+        i = (i + 1) & (tb->size - 1);
+    }
+    return NULL;
+}
+
+/* lock-free: may run concurrently with a writer */
+TString *hetS_sharedlookup(const char *str, size_t l, unsigned int h) {
+    SharedTable *tb = atomicload(&shared);
+    if (tb == NULL || l > HETI_MAXSHORTLEN)
+        return NULL;
+    return lookup(tb, str, l, h);
+}
+
+static void insert(SharedTable *tb, TString *ts) {
+    unsigned int i = ts->hash & (tb->size - 1);
+    while (tb->slot[i] != NULL)
+        i = (i + 1) & (tb->size - 1);
+    atomicstore(&tb->slot[i], ts); /* 'tb' may be already published */
+    tb->nuse++;
+}
+
+/*
+** Make sure the current table has room for one more string (keeping it
+** at most half full), publishing a bigger copy if needed. Must be
+** called by the writer.
+*/
+static SharedTable *reserve(void) {
+    SharedTable *old = shared;
+    SharedTable *tb;
+    unsigned int size, i;
+    if (old != NULL && (old->nuse + 1) * 2 <= old->size)
+        return old;
+    size = (old == NULL) ? MINSHAREDSIZE : old->size * 2;
+    tb = (SharedTable *)malloc(sizesharedtable(size));
+    if (tb == NULL)
+        return NULL;
+    memset(tb, 0, sizesharedtable(size));
+    tb->size = size;
+    tb->previous = old;
+    if (old != NULL) {
+        for (i = 0; i < old->size; i++)
+            if (old->slot[i] != NULL)
+                insert(tb, old->slot[i]);
+    }
+    atomicstore(&shared, tb);
+    return tb;
+}
+
+/*
+** Intern a short string in the pool ('extra' marks reserved words).
+** Returns NULL if the string is too long, the pool is sealed, or memory
+** is exhausted. Inserting into the published table is safe for
+** concurrent lookups: the slot is filled only after the string is
+** complete.
+*/
+TString *hetS_newshared(const char *str, size_t l, int extra) {
+    unsigned int h;
+    SharedTable *tb;
+    TString *ts;
+    if (l > HETI_MAXSHORTLEN)
+        return NULL;
+    h = hetS_hash(str, l, sharedseed_());
+    lockwriter();
+    tb = sealed ? NULL : reserve();
+    ts = (tb == NULL) ? NULL : lookup(tb, str, l, h);
+    if (tb != NULL && ts == NULL) {
+        ts = (TString *)malloc(sizelstring(l));
+        if (ts != NULL) {
+            ts->next = NULL;
+            ts->tt = HET_VSHRSTR;
+            ts->marked = cast_byte(1 << SHAREDBIT);
+            ts->extra = cast_byte(extra);
+            ts->shrlen = cast_byte(l);
+            ts->hash = h;
+            ts->u.hnext = NULL;
+            memcpy(getstr(ts), str, l * sizeof(char));
+            getstr(ts)[l] = '\0';
+            insert(tb, ts);
+        }
+    }
+    unlockwriter();
+    return ts;
+}
+
+/*
+** Reserved words, in the order of their tokens in the lexer (whose
+** 'extra' is the position here plus one). Pool strings are immutable,
+** so the lexer cannot mark them when a state starts; they must be
+** interned already marked.
+*/
+static const char *const reserved[] = {
+    "and", "break", "do", "else", "elseif", "end", "false", "for",
+    "function", "goto", "if", "in", "local", "nil", "not", "or",
+    "repeat", "return", "then", "true", "until", "while"
+};
+
+static int reservedextra(const char *str) {
+    int i;
+    for (i = 0; i < cast_int(sizeof(reserved) / sizeof(reserved[0])); i++) {
+        if (strcmp(str, reserved[i]) == 0)
+            return i + 1;
+    }
+    return 0;
+}
+
+int het_sharestrings(const char *const *strs, int n) {
+    int i;
+    if (atomicload(&sealed))
+        return -1; /* too late: states are already using the pool */
+    for (i = 0; i < n; i++) {
+        if (hetS_newshared(strs[i], strlen(strs[i]),
+                           reservedextra(strs[i])) == NULL &&
+            strlen(strs[i]) <= HETI_MAXSHORTLEN)
+            return -1; /* memory error (or sealed meanwhile) */
+    }
+    return n;
+}
+
+/* free the pool; no state may be using it */
+void het_releasestrings(void) {
+    SharedTable *tb = shared;
+    unsigned int i;
+    if (tb != NULL) {
+        for (i = 0; i < tb->size; i++)
+            free(tb->slot[i]);
+    }
+    while (tb != NULL) {
+        SharedTable *previous = tb->previous;
+        free(tb);
+        tb = previous;
+    }
+    shared = NULL;
+    sealed = 0; /* may be filled again for new states */
+}
+
+/* }====================================================== */
@@ -0,0 +1,91 @@
+#define het_table_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include "het_table.h"
+
+/*
+** {======================================================
+** Typed array parts
+** =======================================================
+*/
+
+#if defined(HET_USE_TYPEDARRAYS)
+
+/*
+** Representation that could hold the first 'size' slots of 'array': a
+** typed one if they are a (non-empty) sequence of integers or of floats
+** followed by empty slots, with its length in 'tlen'.
+*/
+int hetH_typeofarray(const TValue *array, unsigned int size,
+                     unsigned int *tlen) {
+    unsigned int n = 0, i;
+    int atype;
+    if (size == 0 || isempty(&array[0]))
+        return ATYPE_BOXED; /* nothing to gain */
+    else if (ttisinteger(&array[0]))
+        atype = ATYPE_INT;
+    else if (ttisfloat(&array[0]))
+        atype = ATYPE_FLT;
+    else
+        return ATYPE_BOXED;
+    while (n < size && !isempty(&array[n])) {
+        if (atype == ATYPE_INT ? !ttisinteger(&array[n])
+                               : !ttisfloat(&array[n]))
+            return ATYPE_BOXED; /* mixed types */
+        n++;
+    }
+    for (i = n; i < size; i++) {
+        if (!isempty(&array[i]))
+            return ATYPE_BOXED; /* has holes */
+    }
+    *tlen = n;
+    return atype;
+}
+
+/*
+** Move the boxed array part of 't' (whose type was checked with
+** 'hetH_typeofarray') to 'newarray', big enough for its size in the
+** new type. The caller frees the old array.
+*/
+void hetH_unboxarray(Table *t, void *newarray, int atype, unsigned int tlen) {
+    unsigned int i;
+    het_assert(arraytype(t) == ATYPE_BOXED && atype != ATYPE_BOXED);
+    if (atype == ATYPE_INT) {
+        het_Integer *a = cast(het_Integer *, newarray);
+        for (i = 0; i < tlen; i++)
+            a[i] = ivalue(&t->array[i]);
+    } else {
+        het_Number *a = cast(het_Number *, newarray);
+        for (i = 0; i < tlen; i++)
+            a[i] = fltvalue(&t->array[i]);
+    }
+    t->array = cast(TValue *, newarray);
+    t->atype = cast_byte(atype);
+    t->tlen = tlen;
+}
+
+/*
+** Move the typed array part of 't' (with 'size' slots) to 'newarray',
+** an array of 'size' values. The caller frees the old array.
+*/
+void hetH_boxarray(Table *t, TValue *newarray, unsigned int size) {
+    unsigned int i;
+    if (arraytype(t) == ATYPE_INT) {
+        for (i = 0; i < t->tlen; i++)
+            setivalue(&newarray[i], iarray(t)[i]);
+    } else {
+        for (i = 0; i < t->tlen; i++)
+            setfltvalue(&newarray[i], farray(t)[i]);
+    }
+    for (; i < size; i++)
+        setempty(&newarray[i]);
+    t->array = newarray;
+    t->atype = ATYPE_BOXED;
+    t->tlen = 0;
+}
+
+#endif
+
+/* }====================================================== */
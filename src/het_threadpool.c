@@ -0,0 +1,69 @@
+#define het_threadpool_c
+#define HET_CORE
+
+#include "het_prefix.h"
+
+#include <string.h>
+
+#include "het.h"
+#include "het_threadpool.h"
+
+/* an empty pool with no slots (recycling is off until it gets some) */
+void hetE_initpool(ThreadPool *tp) {
+    tp->slots = NULL;
+    tp->n = 0;
+    tp->max = 0;
+    tp->stacksize = HETI_THREADPOOLSTACK;
+    memset(&tp->st, 0, sizeof(tp->st));
+}
+
+/* take a thread over capacity 'max', to be freed; NULL if none */
+het_State *hetE_pooldrain(ThreadPool *tp, int max) {
+    if (tp->n <= max || tp->n == 0)
+        return NULL;
+    return tp->slots[--tp->n];
+}
+
+/*
+** Move the pool to 'slots', with room for 'max' threads (the pool
+** must have been drained to 'max'). Returns the previous array, which
+** the caller frees.
+*/
+het_State **hetE_resizepool(ThreadPool *tp, het_State **slots, int max) {
+    het_State **old = tp->slots;
+    het_assert(tp->n <= max && (max == 0 || slots != NULL));
+    if (tp->n > 0)
+        memcpy(slots, old, cast_sizet(tp->n) * sizeof(het_State *));
+    tp->slots = slots;
+    tp->max = max;
+    return old;
+}
+
+/* a reset thread for 'het_newthread', or NULL if it must allocate one */
+het_State *hetE_poolget(ThreadPool *tp) {
+    if (tp->n == 0) {
+        tp->st.misses++;
+        return NULL;
+    }
+    tp->st.hits++;
+    return tp->slots[--tp->n];
+}
+
+/*
+** Offer a collected (and already reset and trimmed) thread to the
+** pool. Returns false if the pool is full, when the caller frees it.
+*/
+int hetE_poolput(ThreadPool *tp, het_State *L1) {
+    if (tp->n >= tp->max) {
+        tp->st.discarded++;
+        return 0;
+    }
+    tp->slots[tp->n++] = L1;
+    tp->st.recycled++;
+    return 1;
+}
+
+void hetE_poolstats(const ThreadPool *tp, het_ThreadPoolStats *st) {
+    *st = tp->st;
+    st->size = tp->n;
+}
@@ -0,0 +1,149 @@
+#define het_vmstack_c
+#define HET_CORE
+
+/* anonymous mappings and 'madvise' are outside the XSI subset */
+#if !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+#if !defined(_DARWIN_C_SOURCE)
+#define _DARWIN_C_SOURCE
+#endif
+
+#include "het_prefix.h"
+
+#include "het_vmstack.h"
+
+#if defined(HET_USE_VMSTACK)
+
+#if defined(_WIN32)
+
+#include <windows.h>
+
+static size_t pagesize(void) {
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (size_t)si.dwPageSize;
+}
+
+#define vmreserve(n) VirtualAlloc(NULL, (n), MEM_RESERVE, PAGE_NOACCESS)
+#define vmcommit(p,n) (VirtualAlloc((p), (n), MEM_COMMIT, PAGE_READWRITE) != NULL)
+#define vmdecommit(p,n) ((void)VirtualFree((p), (n), MEM_DECOMMIT))
+#define vmrelease(p,n) ((void)(n), (void)VirtualFree((p), 0, MEM_RELEASE))
+
+#elif defined(HET_USE_POSIX)
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#if !defined(MAP_NORESERVE)
+#define MAP_NORESERVE 0
+#endif
+
+static size_t pagesize(void) {
+    return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+static void *vmreserve(size_t n) {
+    void *p = mmap(NULL, n, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS |
+                   MAP_NORESERVE, -1, 0);
+    return (p == MAP_FAILED) ? NULL : p;
+}
+
+#define vmcommit(p,n) (mprotect((p), (n), PROT_READ | PROT_WRITE) == 0)
+
+/* drop the contents (so the pages are freed) and forbid access again */
+#define vmdecommit(p,n) \
+    ((void)madvise((p), (n), MADV_DONTNEED), \
+     (void)mprotect((p), (n), PROT_NONE))
+
+#define vmrelease(p,n) ((void)munmap((p), (n)))
+
+#else
+
+#error "HET_USE_VMSTACK needs HET_USE_POSIX or Windows"
+
+#endif
+
+#if defined(__GNUC__)
+#define addreserved(d) __atomic_add_fetch(&nreserved, (d), __ATOMIC_RELAXED)
+#else /* states using reserved stacks must not run in several threads */
+#define addreserved(d) (nreserved += (d))
+#endif
+
+/* number of reservations alive in the process */
+static int nreserved = 0;
+
+static size_t pageround(size_t n) {
+    size_t ps = pagesize();
+    return (n + ps - 1) / ps * ps;
+}
+
+/*
+** Reserve address space for a stack of up to 'size' bytes, with
+** nothing committed. Returns 0 if HETI_MAXVMSTACKS reservations already
+** exist or the system refuses.
+*/
+int hetD_vmreserve(VMStack *vs, size_t size) {
+    vs->base = NULL;
+    vs->reserved = vs->committed = 0;
+    if (addreserved(1) > HETI_MAXVMSTACKS) {
+        addreserved(-1);
+        return 0;
+    }
+    size = pageround(size);
+    vs->base = cast_charp(vmreserve(size));
+    if (vs->base == NULL) {
+        addreserved(-1);
+        return 0;
+    }
+    vs->reserved = size;
+    return 1;
+}
+
+/*
+** Make the first 'size' bytes usable. Returns 0 when 'size' is beyond
+** the reservation or the system has no memory for it.
+*/
+int hetD_vmcommit(VMStack *vs, size_t size) {
+    if (size <= vs->committed)
+        return 1;
+    if (size > vs->reserved)
+        return 0;
+    size = pageround(size);
+    if (!vmcommit(vs->base + vs->committed, size - vs->committed))
+        return 0;
+    vs->committed = size;
+    return 1;
+}
+
+/*
+** Keep only the first 'size' bytes committed. Stacks shrink and grow
+** often; to avoid paying system calls at each change, pages are given
+** back only when less than half of the committed memory is kept, and
+** then the kept part gets the same slack again.
+*/
+void hetD_vmdecommit(VMStack *vs, size_t size) {
+    size_t keep;
+    if (size >= vs->committed / 2)
+        return;
+    keep = pageround(size + size / 2);
+    if (keep < vs->committed) {
+        vmdecommit(vs->base + keep, vs->committed - keep);
+        vs->committed = keep;
+    }
+}
+
+void hetD_vmrelease(VMStack *vs) {
+    if (vs->base != NULL) {
+        vmrelease(vs->base, vs->reserved);
+        addreserved(-1);
+    }
+    vs->base = NULL;
+    vs->reserved = vs->committed = 0;
+}
+
+#endif